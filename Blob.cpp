@@ -0,0 +1,229 @@
+#include "Blob.hpp"
+
+#include "blob_toc.hpp" //table of contents layout
+#include "compressed_chunk.hpp" //chunks may be stored compressed
+#include "crc32c.hpp" //chunk checksums
+
+#include <stdexcept>
+#include <cstring>
+#include <string>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+Blob::Blob(std::string const &filename_, Verify verify_mode_) : filename(filename_), verify_mode(verify_mode_) {
+	#if defined(_WIN32)
+	file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		file = nullptr;
+		throw std::runtime_error("Failed to open blob '" + filename + "'.");
+	}
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size)) {
+		CloseHandle(file);
+		throw std::runtime_error("Failed to get size of blob '" + filename + "'.");
+	}
+	size = size_t(file_size.QuadPart);
+	if (size != 0) { //(empty files can't be mapped)
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping) {
+			data = reinterpret_cast< uint8_t const * >(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		}
+		if (!data) {
+			if (mapping) CloseHandle(mapping);
+			CloseHandle(file);
+			throw std::runtime_error("Failed to map blob '" + filename + "'.");
+		}
+	}
+	#else
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd == -1) {
+		throw std::runtime_error("Failed to open blob '" + filename + "'.");
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		throw std::runtime_error("Failed to get size of blob '" + filename + "'.");
+	}
+	size = size_t(st.st_size);
+	if (size != 0) { //(empty files can't be mapped)
+		void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapped == MAP_FAILED) {
+			close(fd);
+			throw std::runtime_error("Failed to map blob '" + filename + "'.");
+		}
+		data = reinterpret_cast< uint8_t const * >(mapped);
+	}
+	//the mapping keeps its own reference to the file:
+	close(fd);
+	#endif
+
+	try {
+		read_toc();
+	} catch (...) {
+		unmap(); //(the destructor won't run)
+		throw;
+	}
+
+	corrupt_chunk = entries.size();
+	if (verify_mode == VerifyInBackground) {
+		//(the check only reads the mapping and the entries' checksum fields, which nothing else writes)
+		background_check = std::async(std::launch::async, [this]() -> size_t {
+			for (size_t i = 0; i < entries.size(); ++i) {
+				Entry const &entry = entries[i];
+				if (entry.checksummed && crc32c(data + entry.offset, size_t(entry.size)) != entry.checksum) return i;
+			}
+			return entries.size();
+		});
+	}
+}
+
+Blob::~Blob() {
+	if (background_check.valid()) background_check.wait(); //(it reads the mapping)
+	unmap();
+}
+
+void Blob::verify() {
+	if (background_check.valid()) {
+		corrupt_chunk = background_check.get();
+	}
+	if (corrupt_chunk < entries.size()) {
+		throw std::runtime_error("Chunk '" + entries[corrupt_chunk].magic + "' in blob '" + filename + "' is corrupt (checksum mismatch).");
+	}
+}
+
+void Blob::unmap() {
+	#if defined(_WIN32)
+	if (data) UnmapViewOfFile(data);
+	if (mapping) CloseHandle(mapping);
+	if (file) CloseHandle(file);
+	mapping = file = nullptr;
+	#else
+	if (data) munmap(const_cast< uint8_t * >(data), size);
+	#endif
+	data = nullptr;
+}
+
+void Blob::read_toc() {
+	if (size >= sizeof(BlobHeader) && std::memcmp(data, BlobHeaderMagic, 4) == 0) {
+		BlobHeader header;
+		std::memcpy(&header, data, sizeof(header)); //(copied, since the mapping may not be aligned for it on every platform)
+		if (header.version != BlobVersion) {
+			throw std::runtime_error("Blob '" + filename + "' has version " + std::to_string(header.version) + "; expected version " + std::to_string(BlobVersion) + ".");
+		}
+		if ((size - sizeof(BlobHeader)) / sizeof(BlobTocEntry) < header.chunk_count) {
+			throw std::runtime_error("Blob '" + filename + "' ended inside its table of contents.");
+		}
+		uint8_t const *toc = data + sizeof(BlobHeader);
+		if (crc32c(toc, header.chunk_count * sizeof(BlobTocEntry)) != header.toc_checksum) {
+			throw std::runtime_error("Blob '" + filename + "' has a corrupt table of contents.");
+		}
+		for (uint32_t i = 0; i < header.chunk_count; ++i) {
+			BlobTocEntry toc_entry;
+			std::memcpy(&toc_entry, toc + i * sizeof(BlobTocEntry), sizeof(toc_entry));
+			Entry entry;
+			entry.compressed = (uint8_t(toc_entry.magic[0]) & CompressedMagicFlag) != 0;
+			toc_entry.magic[0] = char(uint8_t(toc_entry.magic[0]) & ~CompressedMagicFlag);
+			entry.magic = std::string(toc_entry.magic, 4);
+			entry.offset = toc_entry.offset;
+			entry.size = toc_entry.size;
+			entry.alignment = toc_entry.alignment;
+			entry.checksummed = true;
+			entry.checksum = toc_entry.checksum;
+			if (entry.offset > size || size - entry.offset < entry.size) {
+				throw std::runtime_error("Chunk '" + entry.magic + "' runs past the end of blob '" + filename + "'.");
+			}
+			if (entry.alignment == 0 || (entry.alignment & (entry.alignment - 1)) != 0 || entry.offset % entry.alignment != 0) {
+				throw std::runtime_error("Chunk '" + entry.magic + "' in blob '" + filename + "' has an invalid alignment.");
+			}
+			if (has_chunk(entry.magic)) {
+				throw std::runtime_error("Blob '" + filename + "' has more than one chunk '" + entry.magic + "'.");
+			}
+			entries.emplace_back(entry);
+		}
+	} else {
+		//no table of contents, so walk the chunks to make one:
+		struct ChunkHeader {
+			char magic[4];
+			uint32_t size;
+		};
+		static_assert(sizeof(ChunkHeader) == 8, "header is packed");
+
+		for (size_t offset = 0; offset < size; ) {
+			if (size - offset < sizeof(ChunkHeader)) {
+				throw std::runtime_error("Blob '" + filename + "' ends with a partial chunk header.");
+			}
+			ChunkHeader header;
+			std::memcpy(&header, data + offset, sizeof(header)); //(header may not be aligned)
+			Entry entry;
+			entry.compressed = (uint8_t(header.magic[0]) & CompressedMagicFlag) != 0;
+			header.magic[0] = char(uint8_t(header.magic[0]) & ~CompressedMagicFlag);
+			entry.magic = std::string(header.magic, 4);
+			entry.offset = offset + sizeof(ChunkHeader);
+			entry.size = header.size;
+			if (size - entry.offset < entry.size) {
+				throw std::runtime_error("Chunk '" + entry.magic + "' runs past the end of blob '" + filename + "'.");
+			}
+			if (has_chunk(entry.magic)) {
+				throw std::runtime_error("Blob '" + filename + "' has more than one chunk '" + entry.magic + "'.");
+			}
+			entries.emplace_back(entry);
+			offset = entry.offset + entry.size;
+		}
+	}
+}
+
+size_t Blob::find(std::string const &magic) const {
+	for (size_t i = 0; i < entries.size(); ++i) {
+		if (entries[i].magic == magic) return i;
+	}
+	return entries.size();
+}
+
+Span< uint8_t > Blob::chunk_bytes(std::string const &magic, size_t element_size, size_t element_align) {
+	size_t index = find(magic);
+	if (index == entries.size()) {
+		throw std::runtime_error("Blob '" + filename + "' has no chunk '" + magic + "'.");
+	}
+	Entry *entry = &entries[index];
+
+	if (!entry->loaded) {
+		uint8_t const *begin = data + entry->offset;
+		if (verify_mode == VerifyOnAccess && entry->checksummed && crc32c(begin, size_t(entry->size)) != entry->checksum) {
+			throw std::runtime_error("Chunk '" + magic + "' in blob '" + filename + "' is corrupt (checksum mismatch).");
+		}
+		if (entry->compressed) {
+			//compressed chunks are inflated into storage owned by the Blob (which is suitably aligned):
+			try {
+				size_t inflated_size = inflated_chunk_size(begin, size_t(entry->size));
+				copies.emplace_back((inflated_size + 7) / 8);
+				inflate_chunk_data(begin, size_t(entry->size), reinterpret_cast< uint8_t * >(copies.back().data()));
+				entry->bytes = Span< uint8_t >(reinterpret_cast< uint8_t const * >(copies.back().data()), inflated_size);
+			} catch (std::runtime_error &e) {
+				verify(); //(if the checksum check already running in the background fails, that's the clearer error)
+				throw std::runtime_error("Compressed chunk '" + magic + "' in blob '" + filename + "': " + e.what());
+			}
+		} else {
+			entry->bytes = Span< uint8_t >(begin, size_t(entry->size));
+		}
+		entry->loaded = true;
+	}
+
+	Span< uint8_t > bytes = entry->bytes;
+	if (bytes.size() % element_size != 0) {
+		throw std::runtime_error("Size of chunk '" + magic + "' in blob '" + filename + "' not divisible by element size.");
+	}
+	if (reinterpret_cast< uintptr_t >(bytes.data()) % element_align != 0) {
+		copies.emplace_back((bytes.size() + 7) / 8);
+		if (!bytes.empty()) std::memcpy(copies.back().data(), bytes.data(), bytes.size());
+		bytes = Span< uint8_t >(reinterpret_cast< uint8_t const * >(copies.back().data()), bytes.size());
+		entry->bytes = bytes; //(so asking again doesn't copy again)
+	}
+	return bytes;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <future>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// 'Span' is a read-only view of an array that something else owns:
+template< typename T >
+struct Span {
+	Span() = default;
+	Span(T const *data, size_t size) : data_(data), size_(size) { }
+
+	T const *data() const { return data_; }
+	size_t size() const { return size_; }
+	bool empty() const { return size_ == 0; }
+	T const *begin() const { return data_; }
+	T const *end() const { return data_ + size_; }
+	T const &operator[](size_t i) const { return data_[i]; }
+
+private:
+	T const *data_ = nullptr;
+	size_t size_ = 0;
+};
+
+// 'Blob' memory-maps a file of chunks and hands out views of each chunk's
+// data directly from the mapping -- nothing is copied, and pages are only
+// read in as they are touched (e.g., by glBufferData).
+//
+// Chunks are found by magic through the file's table of contents (see
+// blob_toc.hpp), so they can be asked for in any order, and chunks nobody
+// asks for are never read. Files without a table of contents (chunks back to
+// back in the read_chunk framing) are indexed when opened, and have no
+// checksums.
+//
+// By default, a chunk's checksum is checked the first time it is asked for.
+// With VerifyInBackground, every chunk is checked on another thread starting
+// as soon as the file is opened, so the check overlaps whatever the caller
+// loads meanwhile; verify() waits for it and throws if a chunk was corrupt.
+//
+// Chunks whose data isn't suitably aligned for their element type are
+// copied once into storage owned by the Blob. So are compressed chunks (see
+// compressed_chunk.hpp), which are inflated there.
+//
+//   Blob blob(data_path("meshes.blob"));
+//   Span< Vertex > vertices = blob.chunk< Vertex >("dat0");
+//
+// Spans are valid for as long as the Blob is.
+
+struct Blob {
+	//when to check chunk checksums:
+	enum Verify : uint8_t {
+		VerifyOnAccess, //each chunk the first time it is asked for (so unused chunks are never read)
+		VerifyInBackground, //every chunk, on a background thread (call verify() before trusting the data)
+	};
+
+	explicit Blob(std::string const &filename, Verify verify_mode = VerifyOnAccess); //maps the file and reads its table of contents; throws on failure
+	~Blob();
+	Blob(Blob const &) = delete;
+	Blob &operator=(Blob const &) = delete;
+
+	//view of the chunk with the given magic, whose size must be a multiple of sizeof(T) (throws if it isn't, or there is no such chunk):
+	template< typename T >
+	Span< T > chunk(std::string const &magic) {
+		Span< uint8_t > bytes = chunk_bytes(magic, sizeof(T), alignof(T));
+		return Span< T >(reinterpret_cast< T const * >(bytes.data()), bytes.size() / sizeof(T));
+	}
+
+	//wait for the background check (with VerifyInBackground) and throw if any chunk was corrupt:
+	void verify();
+
+	//does the blob have a chunk with the given magic (e.g., to pick between versions of a format)?
+	bool has_chunk(std::string const &magic) const { return find(magic) < entries.size(); }
+
+	//one chunk, as listed in the table of contents:
+	struct Entry {
+		std::string magic; //(without the compressed flag)
+		bool compressed = false;
+		uint64_t offset = 0; //of the data, from the start of the file
+		uint64_t size = 0; //of the data as stored
+		uint32_t alignment = 1;
+		bool checksummed = false; //(only packs with a table of contents have checksums)
+		uint32_t checksum = 0;
+		//filled in the first time the chunk is asked for:
+		bool loaded = false;
+		Span< uint8_t > bytes; //(view of the mapping, or of a copy)
+	};
+
+	std::string filename;
+	Verify verify_mode = VerifyOnAccess;
+	uint8_t const *data = nullptr; //the mapped file
+	size_t size = 0;
+	std::vector< Entry > entries; //in file order
+
+private:
+	size_t find(std::string const &magic) const; //index in entries, or entries.size() if there is no such chunk
+	void read_toc(); //fills in 'entries'
+	void unmap();
+	Span< uint8_t > chunk_bytes(std::string const &magic, size_t element_size, size_t element_align);
+
+	std::vector< std::vector< uint64_t > > copies; //aligned copies of misaligned (or inflated) chunks
+
+	std::future< size_t > background_check; //index of the first corrupt chunk, or entries.size() (with VerifyInBackground)
+	size_t corrupt_chunk = 0; //result of background_check, once it is collected
+
+	#ifdef _WIN32
+	void *file = nullptr; //HANDLEs
+	void *mapping = nullptr;
+	#endif
+};
@@ -0,0 +1,157 @@
+#include "GLDebug.hpp"
+
+#include "GL.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace {
+
+//one message, copied out of the callback (long messages are truncated):
+struct Message {
+	GLenum source = 0;
+	GLenum type = 0;
+	GLenum severity = 0;
+	GLuint id = 0;
+	char text[240];
+};
+
+//bounded multi-producer / single-consumer queue: the driver may call back from several
+// threads at once, while only gl_debug_flush reads. Each slot's 'sequence' says whose turn it is:
+//   sequence == position      -- empty, a producer may claim it for 'position'
+//   sequence == position + 1  -- full, the consumer may read it
+struct Ring {
+	static const uint32_t Capacity = 256; //(power of two)
+
+	struct Slot {
+		std::atomic< uint32_t > sequence{0};
+		Message message;
+	};
+	Slot slots[Capacity];
+	std::atomic< uint32_t > head{0}; //next position to claim (producers)
+	uint32_t tail = 0; //next position to read (consumer only)
+	std::atomic< uint32_t > dropped{0}; //messages lost because the ring was full
+
+	Ring() {
+		for (uint32_t i = 0; i < Capacity; ++i) {
+			slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	//(producer) claim a slot, or return nullptr if the ring is full:
+	Slot *claim() {
+		uint32_t position = head.load(std::memory_order_relaxed);
+		while (true) {
+			Slot &slot = slots[position % Capacity];
+			int32_t lag = int32_t(slot.sequence.load(std::memory_order_acquire) - position);
+			if (lag == 0) {
+				if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) return &slot;
+			} else if (lag < 0) {
+				return nullptr; //(the consumer hasn't read this slot's previous message yet)
+			} else {
+				position = head.load(std::memory_order_relaxed);
+			}
+		}
+	}
+	//(producer) hand a filled slot to the consumer:
+	static void publish(Slot *slot, uint32_t position) {
+		slot->sequence.store(position + 1, std::memory_order_release);
+	}
+};
+
+Ring ring;
+bool active = false;
+
+void APIENTRY callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, GLchar const *text, void const *) {
+	Ring::Slot *slot = ring.claim();
+	if (!slot) {
+		ring.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	uint32_t position = slot->sequence.load(std::memory_order_relaxed); //(== the position claimed)
+	Message &message = slot->message;
+	message.source = source;
+	message.type = type;
+	message.severity = severity;
+	message.id = id;
+	size_t count = (length < 0 ? std::strlen(text) : size_t(length));
+	count = std::min(count, sizeof(message.text) - 1);
+	std::memcpy(message.text, text, count);
+	message.text[count] = '\0';
+	Ring::publish(slot, position);
+}
+
+char const *severity_name(GLenum severity) {
+	if (severity == GL_DEBUG_SEVERITY_HIGH) return "error";
+	if (severity == GL_DEBUG_SEVERITY_MEDIUM) return "warning";
+	if (severity == GL_DEBUG_SEVERITY_LOW) return "note";
+	return "info";
+}
+
+char const *type_name(GLenum type) {
+	if (type == GL_DEBUG_TYPE_ERROR) return "error";
+	if (type == GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR) return "deprecated";
+	if (type == GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR) return "undefined behavior";
+	if (type == GL_DEBUG_TYPE_PORTABILITY) return "portability";
+	if (type == GL_DEBUG_TYPE_PERFORMANCE) return "performance";
+	return "other";
+}
+
+} //namespace
+
+bool gl_debug_start(void *(*get_proc_address)(char const *name)) {
+	//KHR_debug is core in 4.3; before that it may be an extension:
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	bool supported = (major > 4 || (major == 4 && minor >= 3));
+	if (!supported) {
+		GLint extensions = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+		for (GLint i = 0; i < extensions && !supported; ++i) {
+			char const *name = reinterpret_cast< char const * >(glGetStringi(GL_EXTENSIONS, i));
+			supported = (name && std::string(name) == "GL_KHR_debug");
+		}
+	}
+	if (!supported) return false;
+
+	//(looked up at runtime, since GL.hpp's prototypes only go up to 3.3 everywhere)
+	auto debug_message_callback = (PFNGLDEBUGMESSAGECALLBACKPROC)get_proc_address("glDebugMessageCallback");
+	auto debug_message_control = (PFNGLDEBUGMESSAGECONTROLPROC)get_proc_address("glDebugMessageControl");
+	if (!debug_message_callback || !debug_message_control) return false;
+
+	debug_message_callback(callback, nullptr);
+	//notifications (e.g., "buffer will use video memory") would just be noise:
+	debug_message_control(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+	glEnable(GL_DEBUG_OUTPUT); //(already on in debug contexts; left asynchronous)
+	active = true;
+	return true;
+}
+
+bool gl_debug_active() {
+	return active;
+}
+
+unsigned gl_debug_flush(std::ostream &out) {
+	unsigned written = 0;
+	while (true) {
+		Ring::Slot &slot = ring.slots[ring.tail % Ring::Capacity];
+		if (slot.sequence.load(std::memory_order_acquire) != ring.tail + 1) break;
+		Message const &message = slot.message;
+		out << "GL " << severity_name(message.severity) << " (" << type_name(message.type) << ", id " << message.id << "): " << message.text << "\n";
+		//hand the slot back to the producers, for the position one lap later:
+		slot.sequence.store(ring.tail + Ring::Capacity, std::memory_order_release);
+		ring.tail += 1;
+		written += 1;
+	}
+	uint32_t dropped = 0;
+	if (ring.dropped.load(std::memory_order_relaxed)) dropped = ring.dropped.exchange(0, std::memory_order_relaxed);
+	if (dropped) {
+		out << "GL debug: " << dropped << " messages dropped (too many between flushes).\n";
+	}
+	if (written || dropped) out.flush();
+	return written;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <iosfwd>
+
+// OpenGL error reporting without sync points. When the context supports
+// KHR_debug (core in GL 4.3), the driver calls back with a message whenever
+// something goes wrong -- possibly from one of its own threads, since output
+// is left asynchronous. The callback only copies the message into a lock-free
+// ring; the main loop prints whatever has collected once per frame:
+//
+//   gl_debug_start(SDL_GL_GetProcAddress); //after creating the context
+//   ...
+//   gl_debug_flush(std::cerr); //e.g., at the end of every frame
+//
+// While the callback is installed, GL_ERRORS() (gl_errors.hpp) skips its
+// glGetError loop, which would otherwise stall until the GPU catches up.
+
+//install the callback on the current context; 'get_proc_address' looks up OpenGL functions by name
+// returns false (and leaves GL_ERRORS() polling) if the context doesn't support KHR_debug:
+bool gl_debug_start(void *(*get_proc_address)(char const *name));
+
+//is the callback installed (so glGetError polling is redundant)?
+bool gl_debug_active();
+
+//write out (and remove) any collected messages; returns the number written:
+// (cheap when there are none: a single atomic load)
+unsigned gl_debug_flush(std::ostream &out);
@@ -0,0 +1,122 @@
+#include "GPUTimers.hpp"
+
+#include "gl_errors.hpp" //helper for dumpping OpenGL error messages
+
+#include <algorithm>
+#include <iomanip>
+
+const uint32_t GPUTimers::Latency;
+const uint32_t GPUTimers::Window;
+
+GPUTimers::GPUTimers(std::vector< std::string > const &pass_names) : names(pass_names) {
+	for (Slot &slot : slots) {
+		slot.queries.assign(2 * names.size(), 0);
+		glGenQueries(GLsizei(slot.queries.size()), slot.queries.data());
+		slot.began.assign(names.size(), false);
+		slot.ended.assign(names.size(), false);
+	}
+	samples.assign(names.size(), std::vector< float >(Window, 0.0f));
+	sample_count.assign(names.size(), 0);
+	GL_ERRORS();
+}
+
+GPUTimers::~GPUTimers() {
+	for (Slot &slot : slots) {
+		glDeleteQueries(GLsizei(slot.queries.size()), slot.queries.data());
+	}
+}
+
+void GPUTimers::collect(Slot &slot) {
+	//only read results once every query to be read is available (results needn't arrive in issue order, so check them all):
+	for (uint32_t p = 0; p < names.size(); ++p) {
+		if (!(slot.began[p] && slot.ended[p])) continue;
+		for (uint32_t i = 0; i < 2; ++i) {
+			GLuint available = GL_FALSE;
+			glGetQueryObjectuiv(slot.queries[2*p+i], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available != GL_TRUE) return; //still in flight; try again later
+		}
+	}
+
+	for (uint32_t p = 0; p < names.size(); ++p) {
+		if (!(slot.began[p] && slot.ended[p])) continue;
+		GLuint64 begin = 0, end = 0;
+		glGetQueryObjectui64v(slot.queries[2*p+0], GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(slot.queries[2*p+1], GL_QUERY_RESULT, &end);
+		samples[p][sample_count[p] % Window] = float(end - begin) * 1.0e-6f;
+		sample_count[p] += 1;
+	}
+	slot.pending = false;
+}
+
+void GPUTimers::begin_frame() {
+	//read back any frames that have finished:
+	for (Slot &slot : slots) {
+		if (slot.pending) collect(slot);
+	}
+
+	Slot &slot = slots[frame % Latency];
+	//if this slot's queries are still in flight, skip measuring this frame rather than wait:
+	slot.recording = !slot.pending;
+	if (slot.recording) {
+		std::fill(slot.began.begin(), slot.began.end(), false);
+		std::fill(slot.ended.begin(), slot.ended.end(), false);
+	}
+}
+
+void GPUTimers::end_frame() {
+	Slot &slot = slots[frame % Latency];
+	if (slot.recording) {
+		slot.pending = true;
+		slot.recording = false;
+	}
+	frame += 1;
+}
+
+void GPUTimers::begin(uint32_t pass) {
+	Slot &slot = slots[frame % Latency];
+	if (!slot.recording || pass >= names.size() || slot.began[pass]) return;
+	glQueryCounter(slot.queries[2*pass+0], GL_TIMESTAMP);
+	slot.began[pass] = true;
+}
+
+void GPUTimers::end(uint32_t pass) {
+	Slot &slot = slots[frame % Latency];
+	if (!slot.recording || pass >= names.size() || !slot.began[pass]) return;
+	glQueryCounter(slot.queries[2*pass+1], GL_TIMESTAMP);
+	slot.ended[pass] = true;
+}
+
+void GPUTimers::report(std::ostream &out) const {
+	out << "GPU time (ms)   mean    p50    p95    p99  [samples]\n";
+	for (uint32_t p = 0; p < names.size(); ++p) {
+		std::vector< float > recent(samples[p].begin(), samples[p].begin() + std::min(sample_count[p], Window));
+		out << "  " << std::left << std::setw(10) << names[p] << std::right;
+		if (recent.empty()) {
+			out << "    (no samples yet)\n";
+			continue;
+		}
+		float mean = 0.0f;
+		for (float s : recent) mean += s;
+		mean /= float(recent.size());
+		std::sort(recent.begin(), recent.end());
+		auto percentile = [&recent](float p) {
+			return recent[std::min(recent.size() - 1, size_t(p * float(recent.size())))];
+		};
+		out << std::fixed << std::setprecision(3)
+			<< std::setw(7) << mean
+			<< std::setw(7) << percentile(0.50f)
+			<< std::setw(7) << percentile(0.95f)
+			<< std::setw(7) << percentile(0.99f)
+			<< "  [" << recent.size() << "]\n";
+		out.unsetf(std::ios::fixed);
+	}
+	out.flush();
+}
+
+void GPUTimers::report_every(float interval, std::ostream &out) {
+	auto now = std::chrono::steady_clock::now();
+	if (std::chrono::duration< float >(now - last_report).count() >= interval) {
+		last_report = now;
+		report(out);
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// 'GPUTimers' measures how long the GPU spends on named passes of a frame,
+// using glQueryCounter(GL_TIMESTAMP) at the start and end of each pass.
+//
+// Queries live in a ring of 'Latency' frames, and results are only collected
+// once the GPU reports them available -- so reading them never stalls the
+// pipeline; they just arrive a few frames late. (If a frame's queries are
+// still pending when the ring comes back around, that frame goes unmeasured.)
+//
+//   GPUTimers timers({"frame", "tiles", "items"});
+//   timers.begin_frame();
+//   { GPUTimers::Scope scope(&timers, 1); ...draw tiles... }
+//   timers.end_frame();
+//   timers.report(std::cout); //rolling mean and percentiles of each pass
+//
+// Needs a current OpenGL context for its whole lifetime.
+
+struct GPUTimers {
+	static const uint32_t Latency = 4; //frames of queries in flight
+	static const uint32_t Window = 240; //samples per pass kept for statistics
+
+	explicit GPUTimers(std::vector< std::string > const &pass_names);
+	~GPUTimers();
+	GPUTimers(GPUTimers const &) = delete;
+	GPUTimers &operator=(GPUTimers const &) = delete;
+
+	//collect any finished results and start recording a new frame:
+	void begin_frame();
+	void end_frame();
+
+	//mark the start and end of a pass (passes may nest or repeat; a pass's time is from its first begin to its last end):
+	void begin(uint32_t pass);
+	void end(uint32_t pass);
+
+	//begins a pass on construction and ends it on destruction (does nothing given nullptr):
+	struct Scope {
+		Scope(GPUTimers *timers_, uint32_t pass_) : timers(timers_), pass(pass_) { if (timers) timers->begin(pass); }
+		~Scope() { if (timers) timers->end(pass); }
+		GPUTimers *timers;
+		uint32_t pass;
+	};
+
+	//print mean / p50 / p95 / p99 (in milliseconds) of each pass over the recent window:
+	void report(std::ostream &out) const;
+
+	//prints a report every 'interval' seconds (call once per frame):
+	void report_every(float interval, std::ostream &out);
+
+	std::vector< std::string > names;
+
+private:
+	struct Slot {
+		std::vector< GLuint > queries; //begin, end timestamp per pass
+		std::vector< bool > began, ended; //which passes were recorded
+		bool pending = false; //queries issued and not yet read back
+		bool recording = false; //this frame is being measured
+	};
+	Slot slots[Latency];
+	uint32_t frame = 0;
+
+	std::vector< std::vector< float > > samples; //ring of recent times (ms) per pass
+	std::vector< uint32_t > sample_count; //total samples taken per pass (ring position = count % Window)
+
+	std::chrono::steady_clock::time_point last_report = std::chrono::steady_clock::now();
+
+	void collect(Slot &slot);
+};
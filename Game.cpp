@@ -1,47 +1,206 @@
 #include "Game.hpp"
 
 #include "gl_errors.hpp" //helper for dumpping OpenGL error messages
-#include "read_chunk.hpp" //helper for reading a vector of structures from a file
+#include "Blob.hpp" //memory-mapped file of chunks
+#include "Profiler.hpp" //PROFILE_ZONE
 #include "data_path.hpp" //helper to get paths relative to executable
+#include "ProgramCache.hpp" //shader programs, reusing linked binaries from earlier runs
 
 #include <glm/gtc/type_ptr.hpp>
 
 #include <iostream>
-#include <fstream>
-#include <map>
+#include <algorithm>
 #include <cstddef>
 #include <random>
 
-//helper defined later; throws if shader compilation fails:
-static GLuint compile_shader(GLenum type, std::string const &source);
+//vertex (written by 'pack-meshes'):
+struct Vertex {
+	glm::vec3 Position;
+	glm::vec3 Normal;
+	glm::u8vec4 Color;
+};
+static_assert(sizeof(Vertex) == 28, "Vertex should be packed.");
+
+//compact vertex (written by 'pack-meshes --compact'):
+struct CompactVertex {
+	glm::u16vec4 Position; //fraction of the mesh's bounding box, as unsigned normalized values; w is padding
+	uint32_t Normal; //GL_INT_2_10_10_10_REV
+	glm::u8vec4 Color;
+};
+static_assert(sizeof(CompactVertex) == 16, "CompactVertex should be packed.");
+
+//names of the meshes Game draws, hashed at compile time (as enumerators must be):
+enum MeshNames : uint32_t {
+	TileName = mesh_name_hash("Tile"),
+	DollName = mesh_name_hash("Doll"),
+	BreadName = mesh_name_hash("bread"),
+	PBName = mesh_name_hash("PB"),
+	JName = mesh_name_hash("J"),
+	CubeName = mesh_name_hash("Cube"),
+};
+
+Game::Game() : Game(*std::unique_ptr< Assets >(new Assets())) {
+}
+
+Game::Assets::Assets() : meshes_blob(data_path("meshes.blob"), Blob::VerifyInBackground) {
+	PROFILE_ZONE("Game::Assets");
+	{ //load mesh data from a binary blob (mapped into memory, not copied -- unless its chunks are compressed):
+		Blob &blob = meshes_blob;
+		//The blob (written by pack-meshes) has five chunks, found through its table of contents:
+		// vertex data (interleaved position/normal/color; "dat0" is Vertex and "dat1" is CompactVertex)
+		// characters ("str0")
+		// an index, mapping a name (range of characters) to a mesh (range of vertex data and range of indices) ("idx2")
+		// a table of name hashes, sorted, with the position in the index of each (see MeshId.hpp) ("ids0")
+		// triangle indices into the vertex data ("ind0")
+		//(any other chunks are skipped)
+
+		//read vertex data:
+		compact = blob.has_chunk("dat1");
+		size_t vertex_count = 0;
+		if (compact) {
+			Span< CompactVertex > vertices = blob.chunk< CompactVertex >("dat1");
+			vertex_bytes = Span< uint8_t >(reinterpret_cast< uint8_t const * >(vertices.data()), vertices.size() * sizeof(CompactVertex));
+			vertex_count = vertices.size();
+		} else {
+			Span< Vertex > vertices = blob.chunk< Vertex >("dat0");
+			vertex_bytes = Span< uint8_t >(reinterpret_cast< uint8_t const * >(vertices.data()), vertices.size() * sizeof(Vertex));
+			vertex_count = vertices.size();
+		}
+
+		//read character data (for names):
+		Span< char > names = blob.chunk< char >("str0");
+
+		//read index:
+		struct IndexEntry {
+			uint32_t name_begin;
+			uint32_t name_end;
+			uint32_t vertex_begin;
+			uint32_t vertex_end;
+			uint32_t index_begin;
+			uint32_t index_end;
+			glm::vec3 min; //bounding box of the mesh
+			glm::vec3 max;
+		};
+		static_assert(sizeof(IndexEntry) == 48, "IndexEntry should be packed.");
+
+		Span< IndexEntry > index_entries = blob.chunk< IndexEntry >("idx2");
+
+		//read name hash -> id table:
+		Span< MeshIdEntry > ids = blob.chunk< MeshIdEntry >("ids0");
+
+		//read triangle indices:
+		indices = blob.chunk< uint32_t >("ind0");
+
+		//meshes are numbered in index order:
+		meshes.reserve(index_entries.size());
+		for (IndexEntry const &e : index_entries) {
+			if (e.name_begin > e.name_end || e.name_end > names.size()) {
+				throw std::runtime_error("invalid name indices in index.");
+			}
+			if (e.vertex_begin > e.vertex_end || e.vertex_end > vertex_count) {
+				throw std::runtime_error("invalid vertex indices in index.");
+			}
+			if (e.index_begin > e.index_end || e.index_end > indices.size()) {
+				throw std::runtime_error("invalid triangle indices in index.");
+			}
+			for (uint32_t i = e.index_begin; i < e.index_end; ++i) {
+				if (indices[i] < e.vertex_begin || indices[i] >= e.vertex_end) {
+					throw std::runtime_error("triangle index outside of its mesh's vertices.");
+				}
+			}
+			Mesh mesh;
+			mesh.first = e.index_begin;
+			mesh.count = e.index_end - e.index_begin;
+			if (compact) {
+				mesh.position_offset = e.min;
+				mesh.position_scale = e.max - e.min;
+			}
+			meshes.emplace_back(mesh);
+		}
+
+		if (ids.size() != meshes.size()) {
+			throw std::runtime_error("id table doesn't match index.");
+		}
+		for (size_t i = 0; i < ids.size(); ++i) {
+			if (ids[i].id >= meshes.size() || (i > 0 && ids[i-1].hash >= ids[i].hash)) {
+				throw std::runtime_error("invalid (or unsorted) id table.");
+			}
+		}
 
-Game::Game() {
+		//look up meshes by name hash (the hashes are compile-time constants, see MeshNames above):
+		auto lookup = [&ids](uint32_t hash, char const *name) -> MeshId {
+			MeshId id = find_mesh_id(ids.begin(), ids.end(), hash);
+			if (id == NoMesh) {
+				throw std::runtime_error(std::string("Mesh named '") + name + "' does not appear in index.");
+			}
+			return id;
+		};
+		//CHANGED (removed cursor)
+		tile_mesh = lookup(TileName, "Tile");
+		//cursor_mesh = lookup(CursorName, "Cursor");
+		doll_mesh = lookup(DollName, "Doll");
+		bread_mesh = lookup(BreadName, "bread");
+		pb_mesh = lookup(PBName, "PB");
+		j_mesh = lookup(JName, "J");
+		cube_mesh = lookup(CubeName, "Cube");
+	}
+
+	{ //touch every page of the vertex and index data, so uploading them doesn't wait on the disk:
+		uint8_t sum = 0;
+		for (size_t i = 0; i < vertex_bytes.size(); i += 4096) sum += vertex_bytes[i];
+		for (size_t i = 0; i < indices.size(); i += 4096 / sizeof(uint32_t)) sum += uint8_t(indices[i]);
+		prefault_sum = sum;
+	}
+
+	//load optimal move counts (written by make-par-table):
+	par_table.load(data_path("par.blob"));
+
+	//the meshes' checksums have been checked in the background meanwhile; make sure they matched:
+	meshes_blob.verify();
+}
+
+Game::Game(Assets &assets) : seed(std::random_device()()), kitchen(seed) {
+	PROFILE_ZONE("Game::Game");
 	{ //create an opengl program to perform sun/sky (well, directional+hemispherical) lighting:
-		GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER,
+		std::string vertex_source =
 			"#version 330\n"
-			"uniform mat4 object_to_clip;\n"
-			"uniform mat4x3 object_to_light;\n"
-			"uniform mat3 normal_to_light;\n"
+			"layout(std140) uniform Scene {\n"
+			"	mat4 world_to_clip;\n"
+			"	vec3 sun_direction;\n"
+			"	vec3 sun_color;\n"
+			"	vec3 sky_direction;\n"
+			"	vec3 sky_color;\n"
+			"};\n"
+			"layout(std140) uniform Object {\n"
+			"	vec3 position_offset;\n" //maps quantized (compact) positions back to object space
+			"	vec3 position_scale;\n"
+			"};\n"
 			"layout(location=0) in vec4 Position;\n" //note: layout keyword used to make sure that the location-0 attribute is always bound to something
 			"in vec3 Normal;\n"
 			"in vec4 Color;\n"
+			"in mat4x3 ObjectToWorld;\n" //per-instance
+			"in vec4 Tint;\n" //per-instance
 			"out vec3 position;\n"
 			"out vec3 normal;\n"
 			"out vec4 color;\n"
 			"void main() {\n"
-			"	gl_Position = object_to_clip * Position;\n"
-			"	position = object_to_light * Position;\n"
-			"	normal = normal_to_light * Normal;\n"
-			"	color = Color;\n"
+			"	position = ObjectToWorld * vec4(position_offset + position_scale * Position.xyz, 1.0);\n"
+			"	gl_Position = world_to_clip * vec4(position, 1.0);\n"
+			//NOTE: instances are only rotated and translated, so the upper 3x3 works for normals (no inverse transpose needed):
+			"	normal = mat3(ObjectToWorld) * Normal;\n"
+			"	color = Color * Tint;\n"
 			"}\n"
-		);
+		;
 
-		GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER,
+		std::string fragment_source =
 			"#version 330\n"
-			"uniform vec3 sun_direction;\n"
-			"uniform vec3 sun_color;\n"
-			"uniform vec3 sky_direction;\n"
-			"uniform vec3 sky_color;\n"
+			"layout(std140) uniform Scene {\n"
+			"	mat4 world_to_clip;\n"
+			"	vec3 sun_direction;\n"
+			"	vec3 sun_color;\n"
+			"	vec3 sky_direction;\n"
+			"	vec3 sky_color;\n"
+			"};\n"
 			"in vec3 position;\n"
 			"in vec3 normal;\n"
 			"in vec4 color;\n"
@@ -61,240 +220,162 @@ Game::Game() {
 			"	}\n"
 			"	fragColor = vec4(color.rgb * total_light, color.a);\n"
 			"}\n"
-		);
+		;
 
-		simple_shading.program = glCreateProgram();
-		glAttachShader(simple_shading.program, vertex_shader);
-		glAttachShader(simple_shading.program, fragment_shader);
-		//shaders are reference counted so this makes sure they are freed after program is deleted:
-		glDeleteShader(vertex_shader);
-		glDeleteShader(fragment_shader);
-
-		//link the shader program and throw errors if linking fails:
-		glLinkProgram(simple_shading.program);
-		GLint link_status = GL_FALSE;
-		glGetProgramiv(simple_shading.program, GL_LINK_STATUS, &link_status);
-		if (link_status != GL_TRUE) {
-			std::cerr << "Failed to link shader program." << std::endl;
-			GLint info_log_length = 0;
-			glGetProgramiv(simple_shading.program, GL_INFO_LOG_LENGTH, &info_log_length);
-			std::vector< GLchar > info_log(info_log_length, 0);
-			GLsizei length = 0;
-			glGetProgramInfoLog(simple_shading.program, GLsizei(info_log.size()), &length, &info_log[0]);
-			std::cerr << "Info log: " << std::string(info_log.begin(), info_log.begin() + length);
-			throw std::runtime_error("failed to link program");
-		}
+		//(compiled and linked on first run, then loaded from the binary cache; throws on failure)
+		simple_shading.program = load_program("simple_shading", vertex_source, fragment_source);
 	}
 
 	{ //read back uniform and attribute locations from the shader program:
-		simple_shading.object_to_clip_mat4 = glGetUniformLocation(simple_shading.program, "object_to_clip");
-		simple_shading.object_to_light_mat4x3 = glGetUniformLocation(simple_shading.program, "object_to_light");
-		simple_shading.normal_to_light_mat3 = glGetUniformLocation(simple_shading.program, "normal_to_light");
-
-		simple_shading.sun_direction_vec3 = glGetUniformLocation(simple_shading.program, "sun_direction");
-		simple_shading.sun_color_vec3 = glGetUniformLocation(simple_shading.program, "sun_color");
-		simple_shading.sky_direction_vec3 = glGetUniformLocation(simple_shading.program, "sky_direction");
-		simple_shading.sky_color_vec3 = glGetUniformLocation(simple_shading.program, "sky_color");
+		simple_shading.Scene_block = glGetUniformBlockIndex(simple_shading.program, "Scene");
+		simple_shading.Object_block = glGetUniformBlockIndex(simple_shading.program, "Object");
+		if (simple_shading.Scene_block == GL_INVALID_INDEX || simple_shading.Object_block == GL_INVALID_INDEX) {
+			throw std::runtime_error("Shader program is missing a uniform block.");
+		}
+		glUniformBlockBinding(simple_shading.program, simple_shading.Scene_block, SceneBinding);
+		glUniformBlockBinding(simple_shading.program, simple_shading.Object_block, ObjectBinding);
 
 		simple_shading.Position_vec4 = glGetAttribLocation(simple_shading.program, "Position");
 		simple_shading.Normal_vec3 = glGetAttribLocation(simple_shading.program, "Normal");
 		simple_shading.Color_vec4 = glGetAttribLocation(simple_shading.program, "Color");
+		simple_shading.ObjectToWorld_mat4x3 = glGetAttribLocation(simple_shading.program, "ObjectToWorld");
+		simple_shading.Tint_vec4 = glGetAttribLocation(simple_shading.program, "Tint");
 	}
 
-	struct Vertex {
-		glm::vec3 Position;
-		glm::vec3 Normal;
-		glm::u8vec4 Color;
-	};
-	static_assert(sizeof(Vertex) == 28, "Vertex should be packed.");
-
-	{ //load mesh data from a binary blob:
-		std::ifstream blob(data_path("meshes.blob"), std::ios::binary);
-		//The blob will be made up of three chunks:
-		// the first chunk will be vertex data (interleaved position/normal/color)
-		// the second chunk will be characters
-		// the third chunk will be an index, mapping a name (range of characters) to a mesh (range of vertex data)
-
-		//read vertex data:
-		std::vector< Vertex > vertices;
-		read_chunk(blob, "dat0", &vertices);
+	{ //upload mesh data to the graphics card (straight from the mapped file):
+		glGenBuffers(1, &meshes_vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, meshes_vbo);
+		glBufferData(GL_ARRAY_BUFFER, assets.vertex_bytes.size(), assets.vertex_bytes.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-		//read character data (for names):
-		std::vector< char > names;
-		read_chunk(blob, "str0", &names);
+		glGenBuffers(1, &meshes_ibo);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshes_ibo);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * assets.indices.size(), assets.indices.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+		meshes = assets.meshes;
+		tile_mesh = assets.tile_mesh;
+		doll_mesh = assets.doll_mesh;
+		bread_mesh = assets.bread_mesh;
+		pb_mesh = assets.pb_mesh;
+		j_mesh = assets.j_mesh;
+		cube_mesh = assets.cube_mesh;
+	}
 
-		//read index:
-		struct IndexEntry {
-			uint32_t name_begin;
-			uint32_t name_end;
-			uint32_t vertex_begin;
-			uint32_t vertex_end;
-		};
-		static_assert(sizeof(IndexEntry) == 16, "IndexEntry should be packed.");
+	bool compact = assets.compact; //which vertex format the blob holds
 
-		std::vector< IndexEntry > index_entries;
-		read_chunk(blob, "idx0", &index_entries);
+	{ //write every mesh's constants into the object uniform buffer, one aligned block each:
+		GLint alignment = 0;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		alignment = std::max(alignment, 1);
+		object_block_stride = (sizeof(ObjectBlock) + alignment - 1) / alignment * alignment;
 
-		if (blob.peek() != EOF) {
-			std::cerr << "WARNING: trailing data in meshes file." << std::endl;
+		std::vector< uint8_t > blocks(object_block_stride * meshes.size(), 0);
+		for (MeshId id = 0; id < meshes.size(); ++id) {
+			ObjectBlock &block = *reinterpret_cast< ObjectBlock * >(blocks.data() + id * object_block_stride);
+			block.position_offset = meshes[id].position_offset;
+			block.position_scale = meshes[id].position_scale;
 		}
 
-		//upload vertex data to the graphics card:
-		glGenBuffers(1, &meshes_vbo);
-		glBindBuffer(GL_ARRAY_BUFFER, meshes_vbo);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-		//create map to store index entries:
-		std::map< std::string, Mesh > index;
-		for (IndexEntry const &e : index_entries) {
-			if (e.name_begin > e.name_end || e.name_end > names.size()) {
-				throw std::runtime_error("invalid name indices in index.");
-			}
-			if (e.vertex_begin > e.vertex_end || e.vertex_end > vertices.size()) {
-				throw std::runtime_error("invalid vertex indices in index.");
-			}
-			Mesh mesh;
-			mesh.first = e.vertex_begin;
-			mesh.count = e.vertex_end - e.vertex_begin;
-			auto ret = index.insert(std::make_pair(
-				std::string(names.begin() + e.name_begin, names.begin() + e.name_end),
-				mesh));
-			if (!ret.second) {
-				throw std::runtime_error("duplicate name in index.");
-			}
-		}
+		glGenBuffers(1, &object_ubo);
+		glBindBuffer(GL_UNIFORM_BUFFER, object_ubo);
+		glBufferData(GL_UNIFORM_BUFFER, blocks.size(), blocks.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
 
-		//look up into index map to extract meshes:
-		auto lookup = [&index](std::string const &name) -> Mesh {
-			auto f = index.find(name);
-			if (f == index.end()) {
-				throw std::runtime_error("Mesh named '" + name + "' does not appear in index.");
-			}
-			return f->second;
-		};
-		//CHANGED (removed cursor)
-		tile_mesh = lookup("Tile");
-		//cursor_mesh = lookup("Cursor");
-		doll_mesh = lookup("Doll");
-		bread_mesh = lookup("bread");
-		pb_mesh = lookup("PB");
-		j_mesh = lookup("J");
-		cube_mesh = lookup("Cube");
+	{ //scene uniform buffer; lights never change, so they are written once here (the camera is written by draw()):
+		SceneBlock scene = SceneBlock(); //(zeroes the padding)
+		scene.world_to_clip = glm::mat4(1.0f);
+		scene.sun_direction = glm::normalize(glm::vec3(-0.2f, 0.2f, 1.0f));
+		scene.sun_color = glm::vec3(0.81f, 0.81f, 0.76f);
+		scene.sky_direction = glm::vec3(0.0f, 1.0f, 0.0f);
+		scene.sky_color = glm::vec3(0.2f, 0.2f, 0.3f);
+
+		glGenBuffers(1, &scene_ubo);
+		glBindBuffer(GL_UNIFORM_BUFFER, scene_ubo);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(SceneBlock), &scene, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+		//(nothing else uses these binding points, so the scene buffer can stay bound)
+		glBindBufferBase(GL_UNIFORM_BUFFER, SceneBinding, scene_ubo);
 	}
 
 	{ //create vertex array object to hold the map from the mesh vertex buffer to shader program attributes:
 		glGenVertexArrays(1, &meshes_for_simple_shading_vao);
 		glBindVertexArray(meshes_for_simple_shading_vao);
 		glBindBuffer(GL_ARRAY_BUFFER, meshes_vbo);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshes_ibo); //(element buffer binding is part of the vertex array object's state)
 		//note that I'm specifying a 3-vector for a 4-vector attribute here, and this is okay to do:
-		glVertexAttribPointer(simple_shading.Position_vec4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLbyte *)0 + offsetof(Vertex, Position));
+		if (compact) {
+			glVertexAttribPointer(simple_shading.Position_vec4, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(CompactVertex), (GLbyte *)0 + offsetof(CompactVertex, Position));
+		} else {
+			glVertexAttribPointer(simple_shading.Position_vec4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLbyte *)0 + offsetof(Vertex, Position));
+		}
 		glEnableVertexAttribArray(simple_shading.Position_vec4);
 		if (simple_shading.Normal_vec3 != -1U) {
-			glVertexAttribPointer(simple_shading.Normal_vec3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLbyte *)0 + offsetof(Vertex, Normal));
+			//(packed formats always have four components; the shader ignores w)
+			if (compact) {
+				glVertexAttribPointer(simple_shading.Normal_vec3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(CompactVertex), (GLbyte *)0 + offsetof(CompactVertex, Normal));
+			} else {
+				glVertexAttribPointer(simple_shading.Normal_vec3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLbyte *)0 + offsetof(Vertex, Normal));
+			}
 			glEnableVertexAttribArray(simple_shading.Normal_vec3);
 		}
 		if (simple_shading.Color_vec4 != -1U) {
-			glVertexAttribPointer(simple_shading.Color_vec4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (GLbyte *)0 + offsetof(Vertex, Color));
+			if (compact) {
+				glVertexAttribPointer(simple_shading.Color_vec4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(CompactVertex), (GLbyte *)0 + offsetof(CompactVertex, Color));
+			} else {
+				glVertexAttribPointer(simple_shading.Color_vec4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (GLbyte *)0 + offsetof(Vertex, Color));
+			}
 			glEnableVertexAttribArray(simple_shading.Color_vec4);
 		}
+
+		//per-instance attributes advance once per instance rather than once per vertex;
+		// draw() points them at each batch's instances before drawing it:
+		glGenBuffers(1, &instances_vbo);
+		for (GLuint c = 0; c < 4; ++c) {
+			glEnableVertexAttribArray(simple_shading.ObjectToWorld_mat4x3 + c);
+			glVertexAttribDivisor(simple_shading.ObjectToWorld_mat4x3 + c, 1);
+		}
+		if (simple_shading.Tint_vec4 != -1U) {
+			glEnableVertexAttribArray(simple_shading.Tint_vec4);
+			glVertexAttribDivisor(simple_shading.Tint_vec4, 1);
+		}
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 	}
 
 	GL_ERRORS();
 
-	//initialize everything
-	initBoard();
-}
+	//optimal move counts (loaded with the assets):
+	par_table.entries.swap(assets.par_table.entries);
+	round_par = par_table.moves(kitchen);
+
+	batches.resize(meshes.size());
 
-void Game::initBoard() {
-	//----------------
 	//set up game board with meshes and rolls:
-	board_meshes.reserve(board_size.x * board_size.y);
-	board_rotations.reserve(board_size.x * board_size.y);
-	//std::mt19937 mt(0xbead1234);
-
-	//global win condition
-	struct win;
-
-	//initialize chef.x chef.x (for second and onward rounds)
-	chef.x = 2;
-	chef.y = 2;
-
-	//initialize certain squares. 0 means empty square, 1 means square 
-	//with chef in it, 2 is square with jelly, 3 is square with peanut
-	//butter, 4 for square with bread, 5 for goal square and 6 for empty
-	//side squares.
-	//four corner squares are zeros
-	// init board
-	for (uint32_t y = 0; y < board_size.y; ++y) {
-		for (uint32_t x = 0; x < board_size.x; ++x) {
-			if (x == 2 and y == 2) {
-				board[x][y] = 1; // set chef position
-			}
-			else {
-				board[x][y] = 0; // init other positions
-								 // set outside board 
-				if ((y == 0 and (x>0 and x<4)) || (y == 4 and (x>0 and x<4)) || 
-					(x == 0 and (y>0 and y<4)) || (x == 4 and (y>0 and y<4))) {
-					board[x][y] = 6; // init other positions
-				}
-			}
-		}
-	}
+	board_meshes.assign(board_size.x * board_size.y, NoMesh);
+	board_rotations.assign(board_size.x * board_size.y, glm::quat());
+	sync_board_meshes();
+	chef_before = chef_after = glm::vec2(kitchen.chef_y(), kitchen.chef_x());
+}
 
-	//Game::spawnFood to add food randomly to the surrounding squares
-	std::vector <std::tuple<int, int>> fillIn;
-	//put in stuff to vector
-	fillIn.push_back(std::tuple<int, int>(0,1));
-	fillIn.push_back(std::tuple<int, int>(0,2));
-	fillIn.push_back(std::tuple<int, int>(0,3));
-	fillIn.push_back(std::tuple<int, int>(1,0));
-	fillIn.push_back(std::tuple<int, int>(2,0));
-	fillIn.push_back(std::tuple<int, int>(3,0));
-	fillIn.push_back(std::tuple<int, int>(4,1));
-	fillIn.push_back(std::tuple<int, int>(4,2));
-	fillIn.push_back(std::tuple<int, int>(4,3));
-	fillIn.push_back(std::tuple<int, int>(1,4));
-	fillIn.push_back(std::tuple<int, int>(2,4));
-	fillIn.push_back(std::tuple<int, int>(3,4));
-	Game::spawnFood(fillIn);
-
-	std::vector< Mesh const * > meshes{&doll_mesh, &pb_mesh, &cube_mesh, &bread_mesh, &j_mesh};
-
-	//initializing board_meshes
-	int val;
-	for (int i=0; i<board_size.x; i++) {
-		for (int j=0; j<board_size.y; j++) {
-			val = board[i][j];
-			int ind = i*board_size.x + j;
-			//std::cout << "val is " << val << std::endl;
-			if (val == 1) { //draw person
-				board_meshes[ind] = meshes[0];
-			}
-			else if (val > 1 and val < 6) { 
-				//draw generic item (PB,J,bread,goal)
-				if (val == 2) { //j
-					board_meshes[ind] = meshes[4];
-				}
-				else if (val == 3) { //pb
-					board_meshes[ind] = meshes[1];
-				}
-				else if (val == 4) { //bread
-					board_meshes[ind] = meshes[3];
-				}
-				else { //goal
-					board_meshes[ind] = meshes[2];
-				}
-			}
-			else {
-				board_meshes[ind] = nullptr;
+void Game::sync_board_meshes() {
+	PROFILE_ZONE("Game::sync_board_meshes");
+	for (uint32_t x = 0; x < board_size.x; ++x) {
+		for (uint32_t y = 0; y < board_size.y; ++y) {
+			MeshId mesh = NoMesh;
+			switch (kitchen.cell(x, y)) {
+				case KitchenState::Chef: break; //chef is drawn separately, interpolated between ticks
+				case KitchenState::J: mesh = j_mesh; break;
+				case KitchenState::PB: mesh = pb_mesh; break;
+				case KitchenState::Bread: mesh = bread_mesh; break;
+				case KitchenState::Goal: mesh = cube_mesh; break;
+				default: break;
 			}
-			board_rotations.emplace_back(glm::quat());
+			board_meshes[x*board_size.x + y] = mesh;
 		}
 	}
-} 
-
+}
 
 Game::~Game() {
 	glDeleteVertexArrays(1, &meshes_for_simple_shading_vao);
@@ -303,186 +384,133 @@ Game::~Game() {
 	glDeleteBuffers(1, &meshes_vbo);
 	meshes_vbo = -1U;
 
+	glDeleteBuffers(1, &meshes_ibo);
+	meshes_ibo = -1U;
+
+	glDeleteBuffers(1, &instances_vbo);
+	instances_vbo = -1U;
+
+	glDeleteBuffers(1, &scene_ubo);
+	scene_ubo = -1U;
+
+	glDeleteBuffers(1, &object_ubo);
+	object_ubo = -1U;
+
 	glDeleteProgram(simple_shading.program);
 	simple_shading.program = -1U;
 
 	GL_ERRORS();
 }
 
-//CHANGED (coded spawnFood, and getFood)
-void Game::spawnFood(std::vector <std::tuple<int, int>> counterSpace) {
-	srand(time(NULL));
-	//fill in all 12 spaces around the chef with something
-	int x;
-	int y;
-	int ind;
-	int len = counterSpace.size();
-	for (int i=0; i<4; i++) {
-		//randomly pick one from list
-		ind = rand()%len;
-		//std::cout << "random val is " << ind << std::endl;
-		x = std::get<0>(counterSpace[ind]);
-		y = std::get<1>(counterSpace[ind]);
-		//std::cout << "x is " << x << std::endl;
-		//std::cout << "y is " << y << std::endl;
-		if (i == 0) { //pick place for PB
-			board[x][y] = 3;
-		}
-		else if (i == 1) { //pick place for J
-			board[x][y] = 2;
-		}
-		else if (i == 2) { //pick place for bread
-			board[x][y] = 4;
+bool Game::handle_event(SDL_Event const &evt, glm::uvec2 window_size) {
+	//ignore any keys that are the result of automatic key repeat:
+	if (evt.type == SDL_KEYDOWN && evt.key.repeat) {
+		return false;
+	}
+	//move chef (or pick up an item) on L/R/U/D press:
+	if (evt.type == SDL_KEYDOWN && evt.key.repeat == 0) {
+		//the keyboard is ignored while a replay is driving the game:
+		if (playback) {
+			return false;
 		}
-		else { //pick a place for goal square
-			board[x][y] = 5;
+
+		KitchenState::Action action;
+		if (evt.key.keysym.scancode == SDL_SCANCODE_UP) {
+			action = KitchenState::Up;
+		} else if (evt.key.keysym.scancode == SDL_SCANCODE_DOWN) {
+			action = KitchenState::Down;
+		} else if (evt.key.keysym.scancode == SDL_SCANCODE_LEFT) {
+			action = KitchenState::Left;
+		} else if (evt.key.keysym.scancode == SDL_SCANCODE_RIGHT) {
+			action = KitchenState::Right;
+		} else {
+			return false;
 		}
-		len -= 1; //so when picking again there is no out of range
-		//delete it entirely from vector
-		counterSpace.erase(counterSpace.begin()+ind);
+		pending.emplace_back(action);
+		return true;
 	}
+	return false;
 }
 
-void Game::getFood(int dir) {
-	int item;
-	int x;
-	int y;
-	if (dir == 0) { //pick up something a row above
-		//check board[chefRow-1][chefCol] for item
-		x = chef.x-1;
-		y = chef.y;
-		item = board[x][y];
-	}
-	else if (dir == 1) { //pick up something a row below
-		//check board[chefRow+1][chefCol] for item
-		x = chef.x+1;
-		y = chef.y;
-		item = board[x][y];
-	}
-	else if (dir == 2) { //pick up something to the left
-		//check board[chefRow][chefCol-1] for item
-		x = chef.x;
-		y = chef.y-1;
-		item = board[x][y];
-	}
-	else { //dir == 3 aka pick up something to the right
-		//check board[chefRow][chefCol+1] for item
-		x = chef.x;
-		y = chef.y+1;
-		item = board[x][y];
+void Game::apply(KitchenState::Action action) {
+	PROFILE_ZONE("Game::apply");
+	if (recording) {
+		recording->record(tick, action);
 	}
-	if (item > 1 and item < 6) { //non empty and non illegal
-		if (item == 5) { //goal square
-			if (win.PB == 1 and win.J == 1 and win.bread == 1) {
-				//round won! reset some variables
-				//set everything to zero for second and onward rounds
-				win.PB = 0;
-				win.J = 0;
-				win.bread = 0;
-				initBoard();
-			}
-		}
-		else {
-			if (item == 3) {//PB
-				win.PB = 1;
-			}
-			else if (item == 2) {//J
-				win.J = 1;
-			}
-			else {//bread
-				win.bread = 1;
-			}
-			//update the board
-			board[x][y] = 6;
-			int ind = board_size.x*x+y;
-			board_meshes[ind] = nullptr;
-		}
+
+	round_moves += 1;
+	if (kitchen.step(action) == KitchenState::Delivered) {
+		std::cout << "Delivered in " << round_moves << " moves (par " << round_par << ")." << std::endl;
+		round_moves = 0;
+		round_par = par_table.moves(kitchen);
 	}
+	sync_board_meshes();
+	dirty = true;
 }
 
-void Game::printouts() {
-	std::cout << "chef.x is: " << chef.x << " and chef.y is: "<< chef.y << std::endl;
-	//print out the board
-	for (int i=0; i<5; i++) {
-		for (int j=0; j<5; j++) {
-			std::cout<<"board at "<<i<<", "<<j<<"is: "<<board[i][j]<<std::endl;
-		}
-	}
+void Game::reset(uint64_t new_seed) {
+	seed = new_seed;
+	kitchen = KitchenState(seed);
+	tick = 0;
+	round_moves = 0;
+	round_par = par_table.moves(kitchen);
+	pending.clear();
+	sync_board_meshes();
+	chef_before = chef_after = glm::vec2(kitchen.chef_y(), kitchen.chef_x());
+	dirty = true;
 }
 
-bool Game::handle_event(SDL_Event const &evt, glm::uvec2 window_size) {
-	//ignore any keys that are the result of automatic key repeat:
-	if (evt.type == SDL_KEYDOWN && evt.key.repeat) {
-		return false;
+void Game::snapshot(Snapshot *snapshot_) const {
+	PROFILE_ZONE("Game::snapshot");
+	Snapshot &snapshot = *snapshot_;
+	snapshot.board_meshes.assign(board_meshes.begin(), board_meshes.end());
+	snapshot.board_rotations.assign(board_rotations.begin(), board_rotations.end());
+	snapshot.chef_before = chef_before;
+	snapshot.chef_after = chef_after;
+}
+
+bool Game::animating() const {
+	return !pending.empty() || playback || chef_before != chef_after;
+}
+
+void Game::play(Replay const *replay) {
+	reset(replay->header.seed);
+	playback = replay;
+	playback_next = 0;
+}
+
+void Game::update(float elapsed) {
+	PROFILE_ZONE("Game::update");
+	//a chef that was sliding during the last tick comes to rest in this one:
+	if (chef_before != chef_after) dirty = true;
+	chef_before = chef_after;
+
+	//apply input that arrived since the last tick:
+	for (auto action : pending) {
+		apply(action);
 	}
-	//move chef on L/R/U/D press:
-	if (evt.type == SDL_KEYDOWN && evt.key.repeat == 0) {
-		//move chef one square to or pick up item
-		if (evt.key.keysym.scancode == SDL_SCANCODE_UP) { //up arrow pressed
-			if (chef.x == 3) { //call getFood
-				getFood(1);
-			}
-			if (chef.x < 3) { //move chef one row down
-				board[chef.x][chef.y] = 0;
-				int oldInd = board_size.x*chef.x + chef.y;
-				board_meshes[oldInd] = nullptr;
-				chef.x += 1;
-				board[chef.x][chef.y] = 1; //move chef's representation on board
-				int newInd = board_size.x*chef.x + chef.y;
-				board_meshes[newInd] = &doll_mesh;
-			}
-			return true;
-		}
-		else if (evt.key.keysym.scancode == SDL_SCANCODE_DOWN) { //down arrow pressed
-			if (chef.x == 1) { //call getFood
-				getFood(0);
-			}
-			if (chef.x > 1) { //move chef one row up
-				board[chef.x][chef.y] = 0;
-				int oldInd = board_size.x*chef.x + chef.y;
-				board_meshes[oldInd] = nullptr;
-				chef.x -= 1;
-				board[chef.x][chef.y] = 1; //move chef's representation on board
-				int newInd = board_size.x*chef.x + chef.y;
-				board_meshes[newInd] = &doll_mesh;
-			}
-			return true;
-		}
-		else if (evt.key.keysym.scancode == SDL_SCANCODE_LEFT) { //left arrow pressed
-			if (chef.y == 1) { //call getFood
-				getFood(2);
-			}
-			if (chef.y > 1) { //move chef one col left
-				board[chef.x][chef.y] = 0;
-				int oldInd = board_size.x*chef.x + chef.y;
-				board_meshes[oldInd] = nullptr;
-				chef.y -= 1;
-				board[chef.x][chef.y] = 1; //move chef's representation on board
-				int newInd = board_size.x*chef.x + chef.y;
-				board_meshes[newInd] = &doll_mesh;
-			}
-			return true;
+	pending.clear();
+
+	//feed recorded actions back in on the ticks they were taken:
+	if (playback) {
+		while (playback_next < playback->events.size() && playback->events[playback_next].tick() <= tick) {
+			apply(playback->events[playback_next].action());
+			playback_next += 1;
 		}
-		else if (evt.key.keysym.scancode == SDL_SCANCODE_RIGHT) { //right arrow pressed
-			if (chef.y == 3) { //call getFood
-				getFood(3);
-			}
-			if (chef.y < 3) { //move chef one col right
-				board[chef.x][chef.y] = 0;
-				int oldInd = board_size.x*chef.x + chef.y;
-				board_meshes[oldInd] = nullptr;
-				chef.y += 1;
-				board[chef.x][chef.y] = 1; //move chef's representation on board
-				int newInd = board_size.x*chef.x + chef.y;
-				board_meshes[newInd] = &doll_mesh;
+		if (playback_next == playback->events.size() && tick >= playback->header.ticks) {
+			if (playback->matches(kitchen)) {
+				std::cout << "Replay finished; final state matches the recording." << std::endl;
+			} else {
+				std::cout << "WARNING: replay finished, but final state does not match the recording." << std::endl;
 			}
-			return true;
+			playback = nullptr;
 		}
 	}
-	return false;
-}
+	tick += 1;
+
+	//(board x runs along kitchen y; see sync_board_meshes)
+	chef_after = glm::vec2(kitchen.chef_y(), kitchen.chef_x());
 
-void Game::update(float elapsed) {
 	/*
 	glm::quat dr = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
 	float amt = elapsed * 1.0f;
@@ -513,10 +541,17 @@ void Game::update(float elapsed) {
 	*/
 }
 
-void Game::draw(glm::uvec2 drawable_size) {
-	//Set up a transformation matrix to fit the board in the window:
-	glm::mat4 world_to_clip;
-	{
+void Game::draw(glm::uvec2 drawable_size, Snapshot const &snapshot, float alpha) {
+	PROFILE_ZONE("Game::draw");
+	if (gpu_timers) {
+		gpu_timers->begin_frame();
+		gpu_timers->begin(FramePass);
+	}
+
+	//Set up a transformation matrix to fit the board in the window (only when the window size changes):
+	if (drawable_size != scene_drawable_size) {
+		scene_drawable_size = drawable_size;
+		glm::mat4 world_to_clip;
 		float aspect = float(drawable_size.x) / float(drawable_size.y);
 
 		//want scale such that board * scale fits in [-aspect,aspect]x[-1.0,1.0] screen box:
@@ -535,89 +570,99 @@ void Game::draw(glm::uvec2 drawable_size) {
 			0.0f, 0.0f,-1.0f, 0.0f,
 			-(scale / aspect) * center.x, -scale * center.y, 0.0f, 1.0f
 		);
+
+		glBindBuffer(GL_UNIFORM_BUFFER, scene_ubo);
+		glBufferSubData(GL_UNIFORM_BUFFER, offsetof(SceneBlock, world_to_clip), sizeof(world_to_clip), glm::value_ptr(world_to_clip));
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
 	}
 
 	//set up graphics pipeline to use data from the meshes and the simple shading program:
 	glBindVertexArray(meshes_for_simple_shading_vao);
 	glUseProgram(simple_shading.program);
 
-	glUniform3fv(simple_shading.sun_color_vec3, 1, glm::value_ptr(glm::vec3(0.81f, 0.81f, 0.76f)));
-	glUniform3fv(simple_shading.sun_direction_vec3, 1, glm::value_ptr(glm::normalize(glm::vec3(-0.2f, 0.2f, 1.0f))));
-	glUniform3fv(simple_shading.sky_color_vec3, 1, glm::value_ptr(glm::vec3(0.2f, 0.2f, 0.3f)));
-	glUniform3fv(simple_shading.sky_direction_vec3, 1, glm::value_ptr(glm::vec3(0.0f, 1.0f, 0.0f)));
-
-	//helper function to draw a given mesh with a given transformation:
-	auto draw_mesh = [&](Mesh const &mesh, glm::mat4 const &object_to_world) {
-		//set up the matrix uniforms:
-		if (simple_shading.object_to_clip_mat4 != -1U) {
-			glm::mat4 object_to_clip = world_to_clip * object_to_world;
-			glUniformMatrix4fv(simple_shading.object_to_clip_mat4, 1, GL_FALSE, glm::value_ptr(object_to_clip));
-		}
-		if (simple_shading.object_to_light_mat4x3 != -1U) {
-			glUniformMatrix4x3fv(simple_shading.object_to_light_mat4x3, 1, GL_FALSE, glm::value_ptr(object_to_world));
-		}
-		if (simple_shading.normal_to_light_mat3 != -1U) {
-			//NOTE: if there isn't any non-uniform scaling in the object_to_world matrix, then the inverse transpose is the matrix itself, and computing it wastes some CPU time:
-			glm::mat3 normal_to_world = glm::inverse(glm::transpose(glm::mat3(object_to_world)));
-			glUniformMatrix3fv(simple_shading.normal_to_light_mat3, 1, GL_FALSE, glm::value_ptr(normal_to_world));
-		}
-
-		//draw the mesh:
-		glDrawArrays(GL_TRIANGLES, mesh.first, mesh.count);
+	//gather instances into one batch per mesh:
+	for (Batch &batch : batches) {
+		batch.instances.clear();
+	}
+	auto add_instance = [this](MeshId mesh, glm::mat4x3 const &object_to_world) {
+		Instance instance;
+		instance.object_to_world = object_to_world;
+		instance.tint = glm::u8vec4(0xff, 0xff, 0xff, 0xff);
+		batches[mesh].instances.emplace_back(instance);
 	};
 
 	for (uint32_t y = 0; y < board_size.y; ++y) {
 		for (uint32_t x = 0; x < board_size.x; ++x) {
-			draw_mesh(tile_mesh,
-				glm::mat4(
-					1.0f, 0.0f, 0.0f, 0.0f,
-					0.0f, 1.0f, 0.0f, 0.0f,
-					0.0f, 0.0f, 1.0f, 0.0f,
-					x+0.5f, y+0.5f,-0.5f, 1.0f
+			add_instance(tile_mesh,
+				glm::mat4x3(
+					1.0f, 0.0f, 0.0f,
+					0.0f, 1.0f, 0.0f,
+					0.0f, 0.0f, 1.0f,
+					x+0.5f, y+0.5f,-0.5f
 				)
 			);
-			int val = board[y][x];
-			//std::cout << "val is " << val << std::endl;
-			if (val==1 || val==2 || val==3 || val==4 || val==5 ) {
-				draw_mesh(*board_meshes[y*board_size.x+x],
-					glm::mat4(
-						1.0f, 0.0f, 0.0f, 0.0f,
-						0.0f, 1.0f, 0.0f, 0.0f,
-						0.0f, 0.0f, 1.0f, 0.0f,
-						x+0.5f, y+0.5f, 0.0f, 1.0f
+			if (snapshot.board_meshes[y*board_size.x+x] != NoMesh) {
+				add_instance(snapshot.board_meshes[y*board_size.x+x],
+					glm::mat4x3(
+						glm::mat4(
+							1.0f, 0.0f, 0.0f, 0.0f,
+							0.0f, 1.0f, 0.0f, 0.0f,
+							0.0f, 0.0f, 1.0f, 0.0f,
+							x+0.5f, y+0.5f, 0.0f, 1.0f
+						)
+						* glm::mat4_cast(snapshot.board_rotations[y*board_size.x+x])
 					)
-					* glm::mat4_cast(board_rotations[y*board_size.x+x])
 				);
 			}
 		}
 	}
 
-	glUseProgram(0);
-
-	GL_ERRORS();
-}
+	{ //chef slides from where it was before the last tick to where it is now:
+		glm::vec2 at = glm::mix(snapshot.chef_before, snapshot.chef_after, alpha);
+		add_instance(doll_mesh,
+			glm::mat4x3(
+				1.0f, 0.0f, 0.0f,
+				0.0f, 1.0f, 0.0f,
+				0.0f, 0.0f, 1.0f,
+				at.x+0.5f, at.y+0.5f, 0.0f
+			)
+		);
+	}
 
+	//upload every batch's instances at once:
+	instances.clear();
+	for (Batch const &batch : batches) {
+		instances.insert(instances.end(), batch.instances.begin(), batch.instances.end());
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, instances_vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(Instance) * instances.size(), instances.data(), GL_STREAM_DRAW);
+
+	//draw each batch with one call, pointing the per-instance attributes at its instances:
+	size_t first = 0;
+	for (MeshId id = 0; id < batches.size(); ++id) {
+		Batch const &batch = batches[id];
+		if (batch.instances.empty()) continue;
+		Mesh const &mesh = meshes[id];
+		GPUTimers::Scope pass_scope(gpu_timers.get(), id == tile_mesh ? TilesPass : ItemsPass);
+		GLbyte const *base = (GLbyte *)0 + first * sizeof(Instance);
+		for (GLuint c = 0; c < 4; ++c) {
+			glVertexAttribPointer(simple_shading.ObjectToWorld_mat4x3 + c, 3, GL_FLOAT, GL_FALSE, sizeof(Instance), base + offsetof(Instance, object_to_world) + c * sizeof(glm::vec3));
+		}
+		if (simple_shading.Tint_vec4 != -1U) {
+			glVertexAttribPointer(simple_shading.Tint_vec4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Instance), base + offsetof(Instance, tint));
+		}
+		glBindBufferRange(GL_UNIFORM_BUFFER, ObjectBinding, object_ubo, id * object_block_stride, sizeof(ObjectBlock));
+		glDrawElementsInstanced(GL_TRIANGLES, mesh.count, GL_UNSIGNED_INT, (GLbyte *)0 + mesh.first * sizeof(uint32_t), GLsizei(batch.instances.size()));
+		first += batch.instances.size();
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
+	glUseProgram(0);
 
-//create and return an OpenGL vertex shader from source:
-static GLuint compile_shader(GLenum type, std::string const &source) {
-	GLuint shader = glCreateShader(type);
-	GLchar const *str = source.c_str();
-	GLint length = GLint(source.size());
-	glShaderSource(shader, 1, &str, &length);
-	glCompileShader(shader);
-	GLint compile_status = GL_FALSE;
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &compile_status);
-	if (compile_status != GL_TRUE) {
-		std::cerr << "Failed to compile shader." << std::endl;
-		GLint info_log_length = 0;
-		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &info_log_length);
-		std::vector< GLchar > info_log(info_log_length, 0);
-		GLsizei length = 0;
-		glGetShaderInfoLog(shader, GLsizei(info_log.size()), &length, &info_log[0]);
-		std::cerr << "Info log: " << std::string(info_log.begin(), info_log.begin() + length);
-		glDeleteShader(shader);
-		throw std::runtime_error("Failed to compile shader.");
+	if (gpu_timers) {
+		gpu_timers->end(FramePass);
+		gpu_timers->end_frame();
 	}
-	return shader;
+
+	GL_ERRORS();
 }
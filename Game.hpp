@@ -1,11 +1,18 @@
 #pragma once
 
 #include "GL.hpp"
+#include "Blob.hpp"
+#include "MeshId.hpp"
+#include "Kitchen.hpp"
+#include "ParTable.hpp"
+#include "Replay.hpp"
+#include "GPUTimers.hpp"
 
 #include <SDL.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
+#include <memory>
 #include <vector>
 
 // The 'Game' struct holds all of the game-relevant state,
@@ -14,7 +21,11 @@
 struct Game {
 	//Game creates OpenGL resources (i.e. vertex buffer objects) in its
 	//constructor and frees them in its destructor.
+	//Game() loads its own assets first; Game(assets) uses assets already loaded
+	// (e.g., on another thread -- see Assets below) and takes their par table:
 	Game();
+	struct Assets;
+	explicit Game(Assets &assets);
 	~Game();
 
 	//handle_event is called when new mouse or keyboard events are received:
@@ -22,34 +33,43 @@ struct Game {
 	//The function should return 'true' if it handled the event.
 	bool handle_event(SDL_Event const &evt, glm::uvec2 window_size);
 
-	//update is called at the start of a new frame, after events are handled:
+	//update is called once per simulation tick (so 'elapsed' is always the tick length),
+	// zero or more times per frame, after events are handled:
 	void update(float elapsed);
 
-	//draw is called after update:
-	void draw(glm::uvec2 drawable_size);
+	//everything draw needs from the game state, copied out so that drawing can
+	// happen on another thread while the game keeps updating:
+	struct Snapshot {
+		std::vector< MeshId > board_meshes;
+		std::vector< glm::quat > board_rotations;
+		glm::vec2 chef_before = glm::vec2(0.0f); //(see chef_before/chef_after below)
+		glm::vec2 chef_after = glm::vec2(0.0f);
+	};
+
+	//copy the current state into 'snapshot' (reuses its storage):
+	void snapshot(Snapshot *snapshot) const;
 
+	//draw is called after update, with a snapshot of the state; 'alpha' (in [0,1]) is how
+	// far the frame is from the snapshot's previous tick toward its latest one, and is used
+	// to interpolate motion. draw only reads the snapshot and its own OpenGL state, so it
+	// can run on a render thread (the one that has the OpenGL context current):
+	void draw(glm::uvec2 drawable_size, Snapshot const &snapshot, float alpha);
 
-	int board[5][5];
 
-	struct{
-		int PB = 0;
-		int J = 0;
-		int bread = 0;
-	}win;
+	//is anything moving on its own (so frames need drawing even without input)?
+	bool animating() const;
 
-	//called during initialization of board. places one each of PB, J, bread and
-	//goal in one of the surrounding squares and fills the remainder with empty
-	//squares
-	void spawnFood(std::vector <std::tuple<int, int>> counterSpace);
+	//rebuilds board_meshes from the kitchen's board:
+	void sync_board_meshes();
 
-	//called by chefMove only if the chef is in a boundary square. If the square
-	//in the direction has food in it, the chef will pick it up. If empty,
-	//nothing happens
-	void getFood(int dir);
+	//applies one action to the kitchen (from a replay, or queued input on a tick):
+	void apply(KitchenState::Action action);
 
-	void printouts();
+	//starts over with a fresh kitchen drawn from 'seed':
+	void reset(uint64_t seed);
 
-	void initBoard();
+	//starts over from the replay's seed and feeds it the replay's actions on their ticks:
+	void play(Replay const *replay);
 
 	//------- opengl resources -------
 
@@ -57,47 +77,139 @@ struct Game {
 	struct {
 		GLuint program = -1U; //program object
 
-		//uniform locations:
-		GLuint object_to_clip_mat4 = -1U;
-		GLuint object_to_light_mat4x3 = -1U;
-		GLuint normal_to_light_mat3 = -1U;
-		GLuint sun_direction_vec3 = -1U;
-		GLuint sun_color_vec3 = -1U;
-		GLuint sky_direction_vec3 = -1U;
-		GLuint sky_color_vec3 = -1U;
+		//uniform block indices (bound to SceneBinding and ObjectBinding):
+		GLuint Scene_block = -1U;
+		GLuint Object_block = -1U;
 
 		//attribute locations:
 		GLuint Position_vec4 = -1U;
 		GLuint Normal_vec3 = -1U;
 		GLuint Color_vec4 = -1U;
+		//(per-instance:)
+		GLuint ObjectToWorld_mat4x3 = -1U; //occupies four consecutive locations, one per column
+		GLuint Tint_vec4 = -1U;
 	} simple_shading;
 
-	//mesh data, stored in a vertex buffer:
+	//uniform buffers, shared by every program that declares the matching (std140) blocks:
+	enum : GLuint {
+		SceneBinding = 0, //camera + lights; updated only when they change
+		ObjectBinding = 1, //per-mesh constants; written once at load, selected per draw with glBindBufferRange
+	};
+
+	struct SceneBlock {
+		glm::mat4 world_to_clip;
+		glm::vec3 sun_direction; float pad0;
+		glm::vec3 sun_color; float pad1;
+		glm::vec3 sky_direction; float pad2;
+		glm::vec3 sky_color; float pad3;
+	};
+	static_assert(sizeof(SceneBlock) == 128, "SceneBlock should match std140 layout.");
+
+	struct ObjectBlock {
+		glm::vec3 position_offset; float pad0;
+		glm::vec3 position_scale; float pad1;
+	};
+	static_assert(sizeof(ObjectBlock) == 32, "ObjectBlock should match std140 layout.");
+
+	GLuint scene_ubo = -1U;
+	glm::uvec2 scene_drawable_size = glm::uvec2(0); //drawable size the scene's world_to_clip was computed for
+
+	GLuint object_ubo = -1U;
+	GLsizeiptr object_block_stride = 0; //sizeof(ObjectBlock) rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+
+	//mesh data, stored in a vertex buffer and indexed by an element buffer:
 	GLuint meshes_vbo = -1U; //vertex buffer holding mesh data
+	GLuint meshes_ibo = -1U; //element buffer holding (uint32) triangle indices into meshes_vbo
 
-	//The location of each mesh in the meshes vertex buffer:
+	//The location of each mesh's indices in the meshes element buffer:
 	struct Mesh {
-		GLint first = 0;
-		GLsizei count = 0;
+		GLuint first = 0; //first index
+		GLsizei count = 0; //number of indices
+		//object-space position = offset + scale * stored position (identity unless the blob uses compact vertices):
+		glm::vec3 position_offset = glm::vec3(0.0f);
+		glm::vec3 position_scale = glm::vec3(1.0f);
 	};
 
-	Mesh tile_mesh;
-	Mesh doll_mesh;
-	Mesh bread_mesh;
-	Mesh pb_mesh;
-	Mesh j_mesh;
-	Mesh cube_mesh;
+	//everything Game needs from disk, read and validated without touching OpenGL, so
+	// main can load it on a worker thread while the window and context are created:
+	struct Assets {
+		Assets(); //maps meshes.blob and loads par.blob; throws on failure
+
+		Blob meshes_blob;
+		bool compact = false; //which vertex format the blob holds ("dat0" or "dat1")
+		Span< uint8_t > vertex_bytes; //(views into meshes_blob, ready to upload)
+		Span< uint32_t > indices;
+		std::vector< Mesh > meshes; //every mesh in the pack, by MeshId
+		MeshId tile_mesh = NoMesh, doll_mesh = NoMesh, bread_mesh = NoMesh, pb_mesh = NoMesh, j_mesh = NoMesh, cube_mesh = NoMesh;
+		ParTable par_table;
+		uint8_t prefault_sum = 0; //(keeps the loop that reads in the mapped pages from being optimized away)
+	};
 
-	GLuint meshes_for_simple_shading_vao = -1U; //vertex array object that describes how to connect the meshes_vbo to the simple_shading_program
+	//every mesh in meshes.blob, by MeshId (mesh i's ObjectBlock is block i of object_ubo):
+	std::vector< Mesh > meshes;
+
+	MeshId tile_mesh = NoMesh;
+	MeshId doll_mesh = NoMesh;
+	MeshId bread_mesh = NoMesh;
+	MeshId pb_mesh = NoMesh;
+	MeshId j_mesh = NoMesh;
+	MeshId cube_mesh = NoMesh;
+
+	//per-instance data, stored in a second vertex buffer that is refilled every frame:
+	struct Instance {
+		glm::mat4x3 object_to_world;
+		glm::u8vec4 tint;
+	};
+	static_assert(sizeof(Instance) == 52, "Instance should be packed.");
+
+	GLuint instances_vbo = -1U;
+
+	GLuint meshes_for_simple_shading_vao = -1U; //vertex array object that describes how to connect the meshes_vbo (and instances_vbo) to the simple_shading_program
+
+	//instances gathered by draw(), one batch (and one draw call) per mesh:
+	struct Batch {
+		std::vector< Instance > instances;
+	};
+	std::vector< Batch > batches; //by MeshId
+	std::vector< Instance > instances; //all batches, back to back, as uploaded
+
+	//if set, draw() measures the GPU time of each of these passes:
+	enum GPUPass : uint32_t { FramePass, TilesPass, ItemsPass };
+	std::unique_ptr< GPUTimers > gpu_timers;
 
 	//------- game state -------
 
+	//board rules and state live in KitchenState so they can be simulated headless:
+	uint64_t seed; //random seed the kitchen was started from
+	KitchenState kitchen;
+	uint32_t tick = 0; //number of update() calls since the kitchen was started
+
+	//actions from the keyboard, applied at the next tick:
+	std::vector< KitchenState::Action > pending;
+
+	//chef position (in board coordinates) before and after the most recent tick, for interpolation:
+	glm::vec2 chef_before = glm::vec2(0.0f);
+	glm::vec2 chef_after = glm::vec2(0.0f);
+
+	//has anything visible changed since the last snapshot()? (used by main's redraw-on-change mode)
+	bool dirty = true;
+
+	//if set, every accepted action is appended (with its tick) here:
+	Replay *recording = nullptr;
+
+	//if set, actions come from here instead of the keyboard:
+	Replay const *playback = nullptr;
+	size_t playback_next = 0; //next event to apply
+
+	//optimal move counts, for scoring each round against par:
+	ParTable par_table;
+	uint32_t round_par = 0; //par for the current round
+	uint32_t round_moves = 0; //moves made so far this round
+
 	glm::uvec2 board_size = glm::uvec2(5,5); //CHANGED
-	std::vector< Mesh const * > board_meshes;
+	std::vector< MeshId > board_meshes; //(NoMesh where there is nothing to draw)
 	std::vector< glm::quat > board_rotations;
 
-	glm::uvec2 chef = glm::vec2(2,2); //initialize chef position
-
 	struct {
 		bool roll_left = false;
 		bool roll_right = false;
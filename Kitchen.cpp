@@ -0,0 +1,116 @@
+#include "Kitchen.hpp"
+
+#include <iostream>
+#include <cstring>
+#include <utility>
+
+constexpr uint32_t KitchenState::FloorMask;
+constexpr uint32_t KitchenState::CounterRingMask;
+
+static_assert(KitchenState::FloorMask == (
+	KitchenState::square_bit(1,1) | KitchenState::square_bit(1,2) | KitchenState::square_bit(1,3) |
+	KitchenState::square_bit(2,1) | KitchenState::square_bit(2,2) | KitchenState::square_bit(2,3) |
+	KitchenState::square_bit(3,1) | KitchenState::square_bit(3,2) | KitchenState::square_bit(3,3)
+), "FloorMask should be the middle 3x3 squares.");
+
+const uint8_t KitchenState::CounterSquares[12] = {
+	1, 2, 3, //(0,1) (0,2) (0,3)
+	5, 10, 15, //(1,0) (2,0) (3,0)
+	21, 22, 23, //(4,1) (4,2) (4,3)
+	9, 14, 19, //(1,4) (2,4) (3,4)
+};
+
+KitchenState::KitchenState(uint64_t seed, uint64_t stream) : rng(seed, stream) {
+	new_round();
+}
+
+void KitchenState::new_round() {
+	held = 0;
+
+	for (uint32_t l = 0; l < LayerCount; ++l) {
+		masks[l] = 0;
+	}
+	masks[ChefLayer] = square_bit(2,2);
+	masks[CounterLayer] = CounterRingMask;
+
+	spawn_food();
+}
+
+void KitchenState::spawn_food() {
+	spawn_food(rng, masks);
+}
+
+void KitchenState::spawn_food(Rng &rng, uint32_t masks[LayerCount]) {
+	//partial Fisher-Yates shuffle: after step i, squares[0..i] are the picks so far:
+	uint8_t squares[12];
+	std::memcpy(squares, CounterSquares, sizeof(squares));
+
+	static const Layer items[4] = { PBLayer, JLayer, BreadLayer, GoalLayer };
+	for (uint32_t i = 0; i < 4; ++i) {
+		uint32_t pick = i + rng.below(12 - i);
+		std::swap(squares[i], squares[pick]);
+
+		uint32_t bit = 1u << squares[i];
+		masks[items[i]] |= bit;
+		masks[CounterLayer] &= ~bit;
+	}
+}
+
+KitchenState::Result KitchenState::step(Action action) {
+	//Up/Right move toward higher bits, Down/Left toward lower:
+	static const uint8_t shift_up[4] = { 5, 0, 0, 1 };
+	static const uint8_t shift_down[4] = { 0, 5, 1, 0 };
+
+	//the chef is always on the floor, so the target never wraps to another row:
+	uint32_t target = (masks[ChefLayer] << shift_up[action]) >> shift_down[action];
+
+	//walk if the target is floor:
+	uint32_t move = 0u - uint32_t((target & FloorMask) != 0);
+	masks[ChefLayer] = (target & move) | (masks[ChefLayer] & ~move);
+
+	//otherwise the target is a counter; pick up whatever food is on it:
+	uint32_t pb = masks[PBLayer] & target;
+	uint32_t j = masks[JLayer] & target;
+	uint32_t bread = masks[BreadLayer] & target;
+	uint32_t food = pb | j | bread;
+	held |= uint8_t((pb != 0) * HeldPB | (j != 0) * HeldJ | (bread != 0) * HeldBread);
+	masks[PBLayer] &= ~pb;
+	masks[JLayer] &= ~j;
+	masks[BreadLayer] &= ~bread;
+	masks[CounterLayer] |= food;
+
+	//...or deliver to the goal, if carrying everything:
+	if ((masks[GoalLayer] & target) && held == HeldAll) {
+		//round won! start the next one:
+		rounds += 1;
+		new_round();
+		return Delivered;
+	}
+
+	return Result((move & Moved) | (uint32_t(food != 0) * Picked));
+}
+
+KitchenState::Cell KitchenState::cell(uint32_t x, uint32_t y) const {
+	uint32_t bit = square_bit(x, y);
+	if (masks[ChefLayer] & bit) return Chef;
+	if (masks[PBLayer] & bit) return PB;
+	if (masks[JLayer] & bit) return J;
+	if (masks[BreadLayer] & bit) return Bread;
+	if (masks[GoalLayer] & bit) return Goal;
+	if (masks[CounterLayer] & bit) return Counter;
+	return Empty;
+}
+
+uint32_t KitchenState::chef_square() const {
+	return lowest_bit_index(masks[ChefLayer]);
+}
+
+void KitchenState::printouts() const {
+	std::cout << "chef.x is: " << chef_x() << " and chef.y is: " << chef_y() << std::endl;
+	//print out the board
+	for (uint32_t i = 0; i < 5; i++) {
+		for (uint32_t j = 0; j < 5; j++) {
+			std::cout << "board at " << i << ", " << j << " is: " << int(cell(i, j)) << std::endl;
+		}
+	}
+}
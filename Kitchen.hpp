@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include "Rng.hpp"
+
+
+// The 'KitchenState' struct holds the rules of Undercooked -- the board,
+// the chef, and what the chef is carrying -- with no dependence on SDL or
+// OpenGL. Game wraps one for interactive play; 'sim' steps them headless.
+//
+// The board is stored as bitboards: bit (x*5 + y) of each mask is square (x,y).
+
+struct KitchenState {
+	//contents of a board square (as reported by cell()):
+	enum Cell : uint8_t {
+		Empty = 0, //floor square the chef can walk on
+		Chef = 1,
+		J = 2,
+		PB = 3,
+		Bread = 4,
+		Goal = 5,
+		Counter = 6, //counter square with nothing on it
+	};
+
+	//one keypress worth of input (names match the arrow keys):
+	enum Action : uint8_t {
+		Up = 0, //chef.x + 1
+		Down = 1, //chef.x - 1
+		Left = 2, //chef.y - 1
+		Right = 3, //chef.y + 1
+	};
+
+	//what a call to step() did:
+	enum Result : uint8_t {
+		Bumped = 0, //walked into a counter with nothing useful on it
+		Moved = 1, //moved one floor square
+		Picked = 2, //picked up PB, J, or bread
+		Delivered = 3, //brought everything to the goal; a new round has started
+	};
+
+	//one mask per occupant type:
+	enum Layer : uint8_t {
+		ChefLayer = 0,
+		PBLayer = 1,
+		JLayer = 2,
+		BreadLayer = 3,
+		GoalLayer = 4,
+		CounterLayer = 5, //counter squares with nothing on them
+		LayerCount = 6,
+	};
+
+	//bits of 'held':
+	enum : uint8_t {
+		HeldPB = 1,
+		HeldJ = 2,
+		HeldBread = 4,
+		HeldAll = 7,
+	};
+
+	static constexpr uint32_t FloorMask = 0x000739c0; //the 3x3 squares the chef walks on
+	static constexpr uint32_t CounterRingMask = 0x00e8c62e; //the 12 squares around the floor
+
+	static constexpr uint32_t square_bit(uint32_t x, uint32_t y) { return 1u << (x * 5 + y); }
+
+	//the twelve counter squares where food and the goal may spawn (as x*5 + y):
+	static const uint8_t CounterSquares[12];
+
+	//starts the first round, with food placement drawn from stream 'stream' of 'seed':
+	explicit KitchenState(uint64_t seed = 0, uint64_t stream = 0);
+
+	//apply one action to the board:
+	Result step(Action action);
+
+	//reset the chef and what it carries, then spawn food for a new round:
+	void new_round();
+
+	//places one each of PB, J, bread and goal on the counter squares:
+	void spawn_food();
+	//...same, for callers that store the masks elsewhere (e.g., KitchenBatch):
+	static void spawn_food(Rng &rng, uint32_t masks[LayerCount]);
+
+	//what is on square (x,y):
+	Cell cell(uint32_t x, uint32_t y) const;
+
+	uint32_t chef_square() const; //chef position as x*5 + y
+	uint32_t chef_x() const { return chef_square() / 5; }
+	uint32_t chef_y() const { return chef_square() % 5; }
+
+	void printouts() const;
+
+	//------- state -------
+
+	uint32_t masks[LayerCount];
+	uint8_t held = 0; //HeldPB | HeldJ | HeldBread
+
+	uint32_t rounds = 0; //number of deliveries so far
+
+	Rng rng;
+};
+
+//the whole state is stepped and copied by the batch simulator:
+static_assert(sizeof(KitchenState) <= 64, "KitchenState should fit in a cache line.");
+
+//index of the lowest set bit of a nonzero mask:
+inline uint32_t lowest_bit_index(uint32_t mask) {
+	//de Bruijn multiply (portable and branch-free):
+	static const uint8_t table[32] = {
+		0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+		31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+	};
+	return table[((mask & (0u - mask)) * 0x077cb531u) >> 27];
+}
@@ -0,0 +1,328 @@
+#include "KitchenBatch.hpp"
+
+#include <cstring>
+
+//x86 kernels are compiled whenever SSE2 is available, and AVX2 is picked at runtime:
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KITCHEN_BATCH_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+KitchenBatch::KitchenBatch(uint32_t count, uint64_t seed) {
+	chef_x.resize(count);
+	chef_y.resize(count);
+	pb.resize(count);
+	j.resize(count);
+	bread.resize(count);
+	goal.resize(count);
+	counter.resize(count);
+	held.resize(count);
+	rounds.resize(count);
+	rngs.resize(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		set(i, KitchenState(seed, i));
+	}
+}
+
+KitchenState KitchenBatch::get(uint32_t i) const {
+	KitchenState state;
+	state.masks[KitchenState::ChefLayer] = KitchenState::square_bit(chef_x[i], chef_y[i]);
+	state.masks[KitchenState::PBLayer] = pb[i];
+	state.masks[KitchenState::JLayer] = j[i];
+	state.masks[KitchenState::BreadLayer] = bread[i];
+	state.masks[KitchenState::GoalLayer] = goal[i];
+	state.masks[KitchenState::CounterLayer] = counter[i];
+	state.held = uint8_t(held[i]);
+	state.rounds = rounds[i];
+	state.rng = rngs[i];
+	return state;
+}
+
+void KitchenBatch::set(uint32_t i, KitchenState const &state) {
+	chef_x[i] = int32_t(state.chef_x());
+	chef_y[i] = int32_t(state.chef_y());
+	pb[i] = state.masks[KitchenState::PBLayer];
+	j[i] = state.masks[KitchenState::JLayer];
+	bread[i] = state.masks[KitchenState::BreadLayer];
+	goal[i] = state.masks[KitchenState::GoalLayer];
+	counter[i] = state.masks[KitchenState::CounterLayer];
+	held[i] = state.held;
+	rounds[i] = state.rounds;
+	rngs[i] = state.rng;
+}
+
+void KitchenBatch::deliver(uint32_t i) {
+	//same as KitchenState::new_round:
+	uint32_t masks[KitchenState::LayerCount];
+	for (uint32_t l = 0; l < KitchenState::LayerCount; ++l) {
+		masks[l] = 0;
+	}
+	masks[KitchenState::CounterLayer] = KitchenState::CounterRingMask;
+	KitchenState::spawn_food(rngs[i], masks);
+
+	chef_x[i] = 2;
+	chef_y[i] = 2;
+	pb[i] = masks[KitchenState::PBLayer];
+	j[i] = masks[KitchenState::JLayer];
+	bread[i] = masks[KitchenState::BreadLayer];
+	goal[i] = masks[KitchenState::GoalLayer];
+	counter[i] = masks[KitchenState::CounterLayer];
+	held[i] = 0;
+	rounds[i] += 1;
+}
+
+//------- kernels -------
+//Each kernel steps kitchens [begin,end) (in whole vectors) and returns where it stopped.
+//They follow KitchenState::step, but with the chef stored as x/y instead of a mask.
+
+static uint32_t step_scalar(KitchenBatch &batch, uint32_t begin, uint32_t end, KitchenState::Action const *actions, KitchenState::Result *results) {
+	for (uint32_t i = begin; i < end; ++i) {
+		int32_t a = actions[i];
+		int32_t x = batch.chef_x[i] + int32_t(a == KitchenState::Up) - int32_t(a == KitchenState::Down);
+		int32_t y = batch.chef_y[i] + int32_t(a == KitchenState::Right) - int32_t(a == KitchenState::Left);
+
+		uint32_t floor = 0u - uint32_t(x >= 1 && x <= 3 && y >= 1 && y <= 3);
+		batch.chef_x[i] = int32_t((uint32_t(x) & floor) | (uint32_t(batch.chef_x[i]) & ~floor));
+		batch.chef_y[i] = int32_t((uint32_t(y) & floor) | (uint32_t(batch.chef_y[i]) & ~floor));
+
+		uint32_t target = 1u << (x * 5 + y);
+		uint32_t pb = batch.pb[i] & target;
+		uint32_t j = batch.j[i] & target;
+		uint32_t bread = batch.bread[i] & target;
+		uint32_t food = pb | j | bread;
+		batch.held[i] |= (pb != 0) * KitchenState::HeldPB | (j != 0) * KitchenState::HeldJ | (bread != 0) * KitchenState::HeldBread;
+		batch.pb[i] &= ~pb;
+		batch.j[i] &= ~j;
+		batch.bread[i] &= ~bread;
+		batch.counter[i] |= food;
+
+		bool delivered = (batch.goal[i] & target) && batch.held[i] == KitchenState::HeldAll;
+		if (results) {
+			results[i] = KitchenState::Result((floor & KitchenState::Moved) | (uint32_t(food != 0) * KitchenState::Picked) | (uint32_t(delivered) * KitchenState::Delivered));
+		}
+		if (delivered) batch.deliver(i);
+	}
+	return end;
+}
+
+#ifdef KITCHEN_BATCH_X86
+
+//start new rounds in the lanes set in 'delivered' (lane k is kitchen i + k):
+static inline void deliver_lanes(KitchenBatch &batch, uint32_t i, uint32_t delivered) {
+	while (delivered) {
+		batch.deliver(i + lowest_bit_index(delivered));
+		delivered &= delivered - 1;
+	}
+}
+
+static uint32_t step_sse2(KitchenBatch &batch, uint32_t begin, uint32_t end, KitchenState::Action const *actions, KitchenState::Result *results) {
+	__m128i const zero = _mm_setzero_si128();
+	__m128i const one = _mm_set1_epi32(1);
+	__m128i const two = _mm_set1_epi32(2);
+	__m128i const three = _mm_set1_epi32(3);
+	__m128i const four = _mm_set1_epi32(4);
+	__m128i const float_bias = _mm_set1_epi32(127);
+	__m128i const held_pb = _mm_set1_epi32(KitchenState::HeldPB);
+	__m128i const held_j = _mm_set1_epi32(KitchenState::HeldJ);
+	__m128i const held_bread = _mm_set1_epi32(KitchenState::HeldBread);
+	__m128i const held_all = _mm_set1_epi32(KitchenState::HeldAll);
+
+	#define LOAD(V) _mm_loadu_si128(reinterpret_cast< __m128i const * >(&batch.V[i]))
+	#define STORE(V, X) _mm_storeu_si128(reinterpret_cast< __m128i * >(&batch.V[i]), X)
+
+	uint32_t i = begin;
+	for (; i + 4 <= end; i += 4) {
+		int32_t packed;
+		std::memcpy(&packed, actions + i, 4);
+		__m128i a = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+
+		//Up = 0, Down = 1, Left = 2, Right = 3:
+		__m128i dx = _mm_sub_epi32(_mm_cmpeq_epi32(a, one), _mm_cmpeq_epi32(a, zero));
+		__m128i dy = _mm_sub_epi32(_mm_cmpeq_epi32(a, two), _mm_cmpeq_epi32(a, three));
+
+		__m128i old_x = LOAD(chef_x);
+		__m128i old_y = LOAD(chef_y);
+		__m128i x = _mm_add_epi32(old_x, dx);
+		__m128i y = _mm_add_epi32(old_y, dy);
+
+		__m128i floor = _mm_and_si128(
+			_mm_and_si128(_mm_cmpgt_epi32(x, zero), _mm_cmpgt_epi32(four, x)),
+			_mm_and_si128(_mm_cmpgt_epi32(y, zero), _mm_cmpgt_epi32(four, y))
+		);
+		STORE(chef_x, _mm_or_si128(_mm_and_si128(floor, x), _mm_andnot_si128(floor, old_x)));
+		STORE(chef_y, _mm_or_si128(_mm_and_si128(floor, y), _mm_andnot_si128(floor, old_y)));
+
+		//1 << (x*5 + y) without a variable shift: build the float 2^n and convert:
+		__m128i square = _mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(x, 2), x), y);
+		__m128i target = _mm_cvttps_epi32(_mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(square, float_bias), 23)));
+
+		__m128i pb = LOAD(pb);
+		__m128i j = LOAD(j);
+		__m128i bread = LOAD(bread);
+		__m128i pb_hit = _mm_and_si128(pb, target);
+		__m128i j_hit = _mm_and_si128(j, target);
+		__m128i bread_hit = _mm_and_si128(bread, target);
+		__m128i food = _mm_or_si128(_mm_or_si128(pb_hit, j_hit), bread_hit);
+		STORE(pb, _mm_andnot_si128(target, pb));
+		STORE(j, _mm_andnot_si128(target, j));
+		STORE(bread, _mm_andnot_si128(target, bread));
+		STORE(counter, _mm_or_si128(LOAD(counter), food));
+
+		__m128i held = LOAD(held);
+		held = _mm_or_si128(held, _mm_andnot_si128(_mm_cmpeq_epi32(pb_hit, zero), held_pb));
+		held = _mm_or_si128(held, _mm_andnot_si128(_mm_cmpeq_epi32(j_hit, zero), held_j));
+		held = _mm_or_si128(held, _mm_andnot_si128(_mm_cmpeq_epi32(bread_hit, zero), held_bread));
+		STORE(held, held);
+
+		__m128i delivered = _mm_andnot_si128(
+			_mm_cmpeq_epi32(_mm_and_si128(LOAD(goal), target), zero),
+			_mm_cmpeq_epi32(held, held_all)
+		);
+
+		if (results) {
+			__m128i result = _mm_or_si128(
+				_mm_or_si128(_mm_and_si128(floor, one), _mm_andnot_si128(_mm_cmpeq_epi32(food, zero), two)),
+				_mm_and_si128(delivered, three)
+			);
+			__m128i bytes = _mm_packus_epi16(_mm_packs_epi32(result, zero), zero);
+			int32_t out = _mm_cvtsi128_si32(bytes);
+			std::memcpy(results + i, &out, 4);
+		}
+
+		deliver_lanes(batch, i, uint32_t(_mm_movemask_ps(_mm_castsi128_ps(delivered))));
+	}
+
+	#undef LOAD
+	#undef STORE
+
+	return i;
+}
+
+TARGET_AVX2
+static uint32_t step_avx2(KitchenBatch &batch, uint32_t begin, uint32_t end, KitchenState::Action const *actions, KitchenState::Result *results) {
+	__m256i const zero = _mm256_setzero_si256();
+	__m256i const one = _mm256_set1_epi32(1);
+	__m256i const two = _mm256_set1_epi32(2);
+	__m256i const three = _mm256_set1_epi32(3);
+	__m256i const four = _mm256_set1_epi32(4);
+	__m256i const held_pb = _mm256_set1_epi32(KitchenState::HeldPB);
+	__m256i const held_j = _mm256_set1_epi32(KitchenState::HeldJ);
+	__m256i const held_bread = _mm256_set1_epi32(KitchenState::HeldBread);
+	__m256i const held_all = _mm256_set1_epi32(KitchenState::HeldAll);
+
+	#define LOAD(V) _mm256_loadu_si256(reinterpret_cast< __m256i const * >(&batch.V[i]))
+	#define STORE(V, X) _mm256_storeu_si256(reinterpret_cast< __m256i * >(&batch.V[i]), X)
+
+	uint32_t i = begin;
+	for (; i + 8 <= end; i += 8) {
+		__m256i a = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast< __m128i const * >(actions + i)));
+
+		//Up = 0, Down = 1, Left = 2, Right = 3:
+		__m256i dx = _mm256_sub_epi32(_mm256_cmpeq_epi32(a, one), _mm256_cmpeq_epi32(a, zero));
+		__m256i dy = _mm256_sub_epi32(_mm256_cmpeq_epi32(a, two), _mm256_cmpeq_epi32(a, three));
+
+		__m256i old_x = LOAD(chef_x);
+		__m256i old_y = LOAD(chef_y);
+		__m256i x = _mm256_add_epi32(old_x, dx);
+		__m256i y = _mm256_add_epi32(old_y, dy);
+
+		__m256i floor = _mm256_and_si256(
+			_mm256_and_si256(_mm256_cmpgt_epi32(x, zero), _mm256_cmpgt_epi32(four, x)),
+			_mm256_and_si256(_mm256_cmpgt_epi32(y, zero), _mm256_cmpgt_epi32(four, y))
+		);
+		STORE(chef_x, _mm256_blendv_epi8(old_x, x, floor));
+		STORE(chef_y, _mm256_blendv_epi8(old_y, y, floor));
+
+		__m256i square = _mm256_add_epi32(_mm256_add_epi32(_mm256_slli_epi32(x, 2), x), y);
+		__m256i target = _mm256_sllv_epi32(one, square);
+
+		__m256i pb = LOAD(pb);
+		__m256i j = LOAD(j);
+		__m256i bread = LOAD(bread);
+		__m256i pb_hit = _mm256_and_si256(pb, target);
+		__m256i j_hit = _mm256_and_si256(j, target);
+		__m256i bread_hit = _mm256_and_si256(bread, target);
+		__m256i food = _mm256_or_si256(_mm256_or_si256(pb_hit, j_hit), bread_hit);
+		STORE(pb, _mm256_andnot_si256(target, pb));
+		STORE(j, _mm256_andnot_si256(target, j));
+		STORE(bread, _mm256_andnot_si256(target, bread));
+		STORE(counter, _mm256_or_si256(LOAD(counter), food));
+
+		__m256i held = LOAD(held);
+		held = _mm256_or_si256(held, _mm256_andnot_si256(_mm256_cmpeq_epi32(pb_hit, zero), held_pb));
+		held = _mm256_or_si256(held, _mm256_andnot_si256(_mm256_cmpeq_epi32(j_hit, zero), held_j));
+		held = _mm256_or_si256(held, _mm256_andnot_si256(_mm256_cmpeq_epi32(bread_hit, zero), held_bread));
+		STORE(held, held);
+
+		__m256i delivered = _mm256_andnot_si256(
+			_mm256_cmpeq_epi32(_mm256_and_si256(LOAD(goal), target), zero),
+			_mm256_cmpeq_epi32(held, held_all)
+		);
+
+		if (results) {
+			__m256i result = _mm256_or_si256(
+				_mm256_or_si256(_mm256_and_si256(floor, one), _mm256_andnot_si256(_mm256_cmpeq_epi32(food, zero), two)),
+				_mm256_and_si256(delivered, three)
+			);
+			//pack 8 x int32 down to 8 bytes (packs work within 128-bit halves):
+			__m128i words = _mm_packs_epi32(_mm256_castsi256_si128(result), _mm256_extracti128_si256(result, 1));
+			_mm_storel_epi64(reinterpret_cast< __m128i * >(results + i), _mm_packus_epi16(words, words));
+		}
+
+		deliver_lanes(batch, i, uint32_t(_mm256_movemask_ps(_mm256_castsi256_ps(delivered))));
+	}
+
+	#undef LOAD
+	#undef STORE
+
+	return i;
+}
+
+#endif //KITCHEN_BATCH_X86
+
+void KitchenBatch::step(KitchenState::Action const *actions, KitchenState::Result *results) {
+	uint32_t i = 0;
+	#ifdef KITCHEN_BATCH_X86
+	if (kernel == AVX2) {
+		i = step_avx2(*this, i, size(), actions, results);
+	}
+	if (kernel >= SSE2) {
+		i = step_sse2(*this, i, size(), actions, results);
+	}
+	#endif
+	//leftover kitchens (or everything, without SIMD):
+	step_scalar(*this, i, size(), actions, results);
+}
+
+KitchenBatch::Kernel KitchenBatch::best_kernel() {
+	#ifdef KITCHEN_BATCH_X86
+	#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] >= 7) {
+		__cpuid(info, 1);
+		bool os_saves_ymm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+		__cpuidex(info, 7, 0);
+		if (os_saves_ymm && (info[1] & (1 << 5))) return AVX2;
+	}
+	#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) return AVX2;
+	#endif
+	return SSE2;
+	#else
+	return Scalar;
+	#endif
+}
+
+char const *KitchenBatch::kernel_name(Kernel kernel) {
+	if (kernel == AVX2) return "avx2";
+	if (kernel == SSE2) return "sse2";
+	return "scalar";
+}
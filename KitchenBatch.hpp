@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Kitchen.hpp"
+
+#include <vector>
+
+// 'KitchenBatch' holds many independent kitchens in structure-of-arrays form
+// and steps all of them at once with SIMD kernels (AVX2 or SSE2 where the CPU
+// has them, plain C++ otherwise). The rules match KitchenState::step exactly.
+
+struct KitchenBatch {
+	//which step kernel to use:
+	enum Kernel : uint8_t {
+		Scalar = 0,
+		SSE2 = 1,
+		AVX2 = 2,
+	};
+
+	//creates 'count' kitchens; kitchen i uses random stream i of 'seed':
+	KitchenBatch(uint32_t count, uint64_t seed = 0);
+
+	uint32_t size() const { return uint32_t(chef_x.size()); }
+
+	//apply actions[i] to kitchen i, writing what happened to results[i] (if results is not null):
+	void step(KitchenState::Action const *actions, KitchenState::Result *results = nullptr);
+
+	//copy a kitchen out of (or into) the batch:
+	KitchenState get(uint32_t i) const;
+	void set(uint32_t i, KitchenState const &state);
+
+	//the best kernel this CPU supports:
+	static Kernel best_kernel();
+	static char const *kernel_name(Kernel kernel);
+
+	Kernel kernel = best_kernel();
+
+	//------- state (one entry per kitchen) -------
+
+	std::vector< int32_t > chef_x;
+	std::vector< int32_t > chef_y;
+	std::vector< uint32_t > pb; //KitchenState::PBLayer
+	std::vector< uint32_t > j; //KitchenState::JLayer
+	std::vector< uint32_t > bread; //KitchenState::BreadLayer
+	std::vector< uint32_t > goal; //KitchenState::GoalLayer
+	std::vector< uint32_t > counter; //KitchenState::CounterLayer
+	std::vector< uint32_t > held; //KitchenState::held
+	std::vector< uint32_t > rounds;
+	std::vector< Rng > rngs;
+
+	//starts a new round in kitchen i after a delivery:
+	void deliver(uint32_t i);
+};
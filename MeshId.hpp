@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+// Meshes in a pack (meshes.blob) are numbered 0..N-1 in the order of its index,
+// so per-mesh data can live in flat arrays indexed by 'MeshId'.
+//
+// Names are resolved to IDs through a table of (name hash, id) pairs that
+// pack-meshes writes sorted by hash (chunk "ids0"), refusing to write a pack
+// where two names collide. Since the hash is constexpr, code that knows the
+// name up front looks a mesh up with a binary search over integers -- no
+// strings are built or compared at runtime:
+//
+//   constexpr uint32_t Tile = mesh_name_hash("Tile");
+//   MeshId tile = find_mesh_id(table.begin(), table.end(), Tile);
+
+typedef uint32_t MeshId;
+constexpr MeshId NoMesh = ~0u; //(not a mesh)
+
+//32-bit FNV-1a of a mesh name:
+constexpr uint32_t mesh_name_hash(char const *name, uint32_t hash = 0x811c9dc5u) {
+	return *name ? mesh_name_hash(name + 1, (hash ^ uint8_t(*name)) * 0x01000193u) : hash;
+}
+
+//one entry of the "ids0" chunk:
+struct MeshIdEntry {
+	uint32_t hash; //mesh_name_hash of the name
+	MeshId id; //position in the pack's index
+};
+static_assert(sizeof(MeshIdEntry) == 8, "MeshIdEntry should be packed.");
+
+//the id with the given name hash in a table sorted by hash, or NoMesh:
+inline MeshId find_mesh_id(MeshIdEntry const *begin, MeshIdEntry const *end, uint32_t hash) {
+	MeshIdEntry const *first = begin, *last = end; //(lower bound)
+	while (first < last) {
+		MeshIdEntry const *mid = first + (last - first) / 2;
+		if (mid->hash < hash) first = mid + 1;
+		else last = mid;
+	}
+	return (first != end && first->hash == hash) ? first->id : NoMesh;
+}
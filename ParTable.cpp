@@ -0,0 +1,60 @@
+#include "ParTable.hpp"
+
+#include "read_chunk.hpp" //helper for reading a vector of structures from a file
+
+#include <fstream>
+
+constexpr uint32_t ParTable::Layouts;
+constexpr uint32_t ParTable::Size;
+
+void ParTable::load(std::string const &filename) {
+	std::ifstream blob(filename, std::ios::binary);
+	if (!blob) {
+		throw std::runtime_error("Failed to open par table '" + filename + "'.");
+	}
+	read_chunk(blob, "par0", &entries);
+	if (entries.size() != Size) {
+		throw std::runtime_error("Par table '" + filename + "' has the wrong number of entries.");
+	}
+}
+
+uint32_t ParTable::layout_index(uint32_t pb, uint32_t j, uint32_t bread, uint32_t goal) {
+	//rank the placement as a partial permutation (each pick skips the squares already used):
+	uint32_t j_rank = j - (j > pb);
+	uint32_t bread_rank = bread - (bread > pb) - (bread > j);
+	uint32_t goal_rank = goal - (goal > pb) - (goal > j) - (goal > bread);
+	return ((pb * 11 + j_rank) * 10 + bread_rank) * 9 + goal_rank;
+}
+
+uint32_t ParTable::index(KitchenState const &state) {
+	//counter index (0-11) of each square:
+	static struct CounterIndex {
+		uint8_t of[25];
+		CounterIndex() {
+			for (uint32_t i = 0; i < 12; ++i) {
+				of[KitchenState::CounterSquares[i]] = uint8_t(i);
+			}
+		}
+	} const counter_index;
+
+	//food already held no longer matters, so any square not otherwise in use will do:
+	uint32_t used = state.masks[KitchenState::GoalLayer];
+	for (uint32_t k = 0; k < 3; ++k) {
+		used |= state.masks[KitchenState::PBLayer + k];
+	}
+
+	uint32_t food[3];
+	for (uint32_t k = 0; k < 3; ++k) {
+		if (state.held & (1 << k)) {
+			uint32_t unused = KitchenState::CounterRingMask & ~used;
+			food[k] = counter_index.of[lowest_bit_index(unused)];
+			used |= unused & (0u - unused);
+		} else {
+			food[k] = counter_index.of[lowest_bit_index(state.masks[KitchenState::PBLayer + k])];
+		}
+	}
+	uint32_t goal = counter_index.of[lowest_bit_index(state.masks[KitchenState::GoalLayer])];
+
+	uint32_t chef = (state.chef_x() - 1) * 3 + (state.chef_y() - 1);
+	return (layout_index(food[0], food[1], food[2], goal) * 9 + chef) * 8 + state.held;
+}
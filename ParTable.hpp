@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Kitchen.hpp"
+
+#include <string>
+#include <vector>
+
+// 'ParTable' holds the optimal ("par") number of actions left, and the first
+// action of an optimal sequence, for every state of every spawn layout:
+//   12*11*10*9 placements of PB, J, bread and goal
+//   x 9 chef squares x 8 sets of held food.
+// The table is solved by 'make-par-table' (BFS using KitchenState::step) and
+// stored in dist/par.blob, so lookups are a single array read.
+
+struct ParTable {
+	static constexpr uint32_t Layouts = 12 * 11 * 10 * 9;
+	static constexpr uint32_t Size = Layouts * 9 * 8;
+
+	//load the table written by make-par-table (throws on failure):
+	void load(std::string const &filename);
+
+	//actions left in an optimal play-through from 'state':
+	uint32_t moves(KitchenState const &state) const { return entries[index(state)] >> 2; }
+
+	//first action of an optimal play-through from 'state':
+	KitchenState::Action first_action(KitchenState const &state) const { return KitchenState::Action(entries[index(state)] & 3); }
+
+	//position of 'state' in the table:
+	static uint32_t index(KitchenState const &state);
+
+	//position of the placement of (pb, j, bread, goal) -- indices into the twelve counter squares -- in [0, Layouts):
+	static uint32_t layout_index(uint32_t pb, uint32_t j, uint32_t bread, uint32_t goal);
+
+	//entries are (moves << 2) | first action:
+	std::vector< uint8_t > entries;
+};
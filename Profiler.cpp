@@ -0,0 +1,135 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+
+//one thread's recent zones; only that thread writes, but the trace writer may read at any time:
+struct Ring {
+	static const uint64_t Capacity = 1 << 16;
+
+	struct Zone {
+		//(atomics, so a read that races with an overwrite is detectable rather than undefined; on x86 these are plain moves)
+		std::atomic< char const * > name{nullptr};
+		std::atomic< uint64_t > begin{0};
+		std::atomic< uint64_t > end{0};
+	};
+
+	std::vector< Zone > zones = std::vector< Zone >(Capacity);
+	std::atomic< uint64_t > written{0}; //zones ever written (slot = index % Capacity)
+	uint32_t tid = 0;
+	std::string name; //(guarded by rings_mutex)
+};
+
+std::mutex rings_mutex;
+std::vector< std::unique_ptr< Ring > > rings; //never shrinks, so zones from finished threads can still be written out
+
+thread_local Ring *ring = nullptr;
+
+Ring &this_thread_ring() {
+	if (!ring) {
+		std::lock_guard< std::mutex > lock(rings_mutex);
+		rings.emplace_back(new Ring);
+		ring = rings.back().get();
+		ring->tid = uint32_t(rings.size());
+	}
+	return *ring;
+}
+
+void write_json_string(std::ostream &out, std::string const &str) {
+	out << '"';
+	for (char c : str) {
+		if (c == '"' || c == '\\') out << '\\' << c;
+		else if (uint8_t(c) < 0x20) out << ' ';
+		else out << c;
+	}
+	out << '"';
+}
+
+} //namespace
+
+const uint64_t Ring::Capacity;
+
+uint64_t profile_now() {
+	return uint64_t(std::chrono::duration_cast< std::chrono::nanoseconds >(std::chrono::steady_clock::now() - start).count());
+}
+
+void profile_record(char const *name, uint64_t begin, uint64_t end) {
+	Ring &r = this_thread_ring();
+	uint64_t index = r.written.load(std::memory_order_relaxed);
+	Ring::Zone &zone = r.zones[index % Ring::Capacity];
+	zone.name.store(name, std::memory_order_release);
+	zone.begin.store(begin, std::memory_order_release);
+	zone.end.store(end, std::memory_order_release);
+	r.written.store(index + 1, std::memory_order_release);
+}
+
+void profile_name_thread(std::string const &name) {
+	Ring &r = this_thread_ring();
+	std::lock_guard< std::mutex > lock(rings_mutex);
+	r.name = name;
+}
+
+void profile_write_chrome_trace(std::string const &filename, float seconds) {
+	uint64_t now = profile_now();
+	uint64_t since = (seconds * 1.0e9f < float(now) ? now - uint64_t(seconds * 1.0e9f) : 0);
+
+	std::ofstream out(filename);
+	if (!out) {
+		throw std::runtime_error("Failed to open '" + filename + "' for writing trace.");
+	}
+
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	auto separator = [&]() {
+		if (!first) out << ",\n";
+		first = false;
+	};
+
+	std::lock_guard< std::mutex > lock(rings_mutex);
+	for (auto const &r : rings) {
+		separator();
+		out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << r->tid << ",\"args\":{\"name\":";
+		write_json_string(out, r->name.empty() ? "thread " + std::to_string(r->tid) : r->name);
+		out << "}}";
+
+		//copy out the ring, then drop anything the owning thread may have overwritten during the copy:
+		uint64_t before = r->written.load(std::memory_order_acquire);
+		uint64_t begin = (before > Ring::Capacity ? before - Ring::Capacity : 0);
+		struct Copy { char const *name; uint64_t begin, end; };
+		std::vector< Copy > copies;
+		copies.reserve(before - begin);
+		for (uint64_t i = begin; i < before; ++i) {
+			Ring::Zone const &zone = r->zones[i % Ring::Capacity];
+			copies.push_back(Copy{zone.name.load(std::memory_order_acquire), zone.begin.load(std::memory_order_acquire), zone.end.load(std::memory_order_acquire)});
+		}
+		//(any overwrite seen above was by a write at or before index 'after', which may still be in progress)
+		uint64_t after = r->written.load(std::memory_order_acquire);
+		uint64_t valid = (after + 1 > Ring::Capacity ? after + 1 - Ring::Capacity : 0);
+
+		for (uint64_t i = std::max(begin, valid); i < before; ++i) {
+			Copy const &zone = copies[i - begin];
+			if (zone.end < since || !zone.name) continue;
+			separator();
+			out << "{\"name\":";
+			write_json_string(out, zone.name);
+			out << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << r->tid
+				<< ",\"ts\":" << (zone.begin / 1000) << "." << (zone.begin / 100 % 10)
+				<< ",\"dur\":" << ((zone.end - zone.begin) / 1000) << "." << ((zone.end - zone.begin) / 100 % 10)
+				<< "}";
+		}
+	}
+	out << "\n]}\n";
+	if (!out) {
+		throw std::runtime_error("Failed to write trace to '" + filename + "'.");
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// A small in-process CPU profiler. Scoped zones record their begin and end
+// times into a per-thread ring buffer (no locks, and only a couple of clock
+// reads per zone); the most recent few seconds of every thread can then be
+// written out as Chrome trace-event JSON, to open in chrome://tracing or
+// https://ui.perfetto.dev:
+//
+//   void Game::update(float elapsed) {
+//       PROFILE_ZONE("Game::update");
+//       ...
+//   }
+//
+//   profile_write_chrome_trace("trace.json", 10.0f); //last ten seconds
+//
+// Zone names must be string literals (or otherwise live forever), since only
+// the pointer is stored. Defining NO_PROFILE compiles the zones out.
+
+//nanoseconds since the profiler started:
+uint64_t profile_now();
+
+//record a zone on the calling thread's ring:
+void profile_record(char const *name, uint64_t begin, uint64_t end);
+
+//name the calling thread in traces (otherwise threads are numbered):
+void profile_name_thread(std::string const &name);
+
+//write the zones that ended in the last 'seconds' to 'filename' (throws on failure):
+void profile_write_chrome_trace(std::string const &filename, float seconds);
+
+struct ProfileZone {
+	explicit ProfileZone(char const *name_) : name(name_), begin(profile_now()) { }
+	~ProfileZone() { profile_record(name, begin, profile_now()); }
+	ProfileZone(ProfileZone const &) = delete;
+	ProfileZone &operator=(ProfileZone const &) = delete;
+	char const *name;
+	uint64_t begin;
+};
+
+#define PROFILE_CONCAT2(A, B) A ## B
+#define PROFILE_CONCAT(A, B) PROFILE_CONCAT2(A, B)
+
+#ifdef NO_PROFILE
+#define PROFILE_ZONE(NAME) do { } while (0)
+#else
+#define PROFILE_ZONE(NAME) ProfileZone PROFILE_CONCAT(profile_zone_, __LINE__)(NAME)
+#endif
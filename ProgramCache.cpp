@@ -0,0 +1,227 @@
+#include "ProgramCache.hpp"
+
+#include "data_path.hpp" //user_path, where binaries are kept
+#include "read_chunk.hpp"
+#include "write_chunk.hpp"
+
+#ifdef _WIN32
+#include <SDL.h> //(for SDL_GL_GetProcAddress; gl_shims only covers 3.3)
+#include <process.h> //_getpid
+#else
+#include <unistd.h> //getpid
+#endif
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+//cache file layout (read_chunk framing):
+//  "prh0" -- one Header
+//  "prb0" -- the program binary, as returned by glGetProgramBinary
+struct Header {
+	uint64_t key = 0; //see program_key
+	uint32_t format = 0; //binary format from glGetProgramBinary
+	uint32_t reserved = 0;
+};
+static_assert(sizeof(Header) == 16, "Header should be packed.");
+
+//program binary entry points (core in 4.1, above what GL.hpp guarantees):
+struct {
+	PFNGLGETPROGRAMBINARYPROC GetProgramBinary = nullptr;
+	PFNGLPROGRAMBINARYPROC ProgramBinary = nullptr;
+	PFNGLPROGRAMPARAMETERIPROC ProgramParameteri = nullptr;
+} gl;
+
+//is program binary support available (looking up the entry points the first time)?
+bool binaries_supported() {
+	static bool supported = [](){
+		GLint major = 0, minor = 0;
+		glGetIntegerv(GL_MAJOR_VERSION, &major);
+		glGetIntegerv(GL_MINOR_VERSION, &minor);
+		bool extension = (major > 4 || (major == 4 && minor >= 1));
+		if (!extension) {
+			GLint extensions = 0;
+			glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+			for (GLint i = 0; i < extensions && !extension; ++i) {
+				char const *name = reinterpret_cast< char const * >(glGetStringi(GL_EXTENSIONS, i));
+				extension = (name && std::string(name) == "GL_ARB_get_program_binary");
+			}
+		}
+		if (!extension) return false;
+
+		//some drivers support the extension but no formats, which means it can't actually be used:
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		if (formats == 0) return false;
+
+		#ifdef _WIN32
+		gl.GetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)SDL_GL_GetProcAddress("glGetProgramBinary");
+		gl.ProgramBinary = (PFNGLPROGRAMBINARYPROC)SDL_GL_GetProcAddress("glProgramBinary");
+		gl.ProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)SDL_GL_GetProcAddress("glProgramParameteri");
+		#else
+		gl.GetProgramBinary = glGetProgramBinary;
+		gl.ProgramBinary = glProgramBinary;
+		gl.ProgramParameteri = glProgramParameteri;
+		#endif
+		return gl.GetProgramBinary && gl.ProgramBinary && gl.ProgramParameteri;
+	}();
+	return supported;
+}
+
+//FNV-1a (64-bit) over the sources and the strings that identify the driver:
+uint64_t program_key(std::string const &vertex_source, std::string const &fragment_source) {
+	uint64_t h = 0xcbf29ce484222325ull;
+	auto add = [&h](char const *str) {
+		for (char const *c = (str ? str : ""); *c; ++c) {
+			h = (h ^ uint8_t(*c)) * 0x100000001b3ull;
+		}
+		h = (h ^ 0xff) * 0x100000001b3ull; //(separator, so "ab"+"c" and "a"+"bc" differ)
+	};
+	add(vertex_source.c_str());
+	add(fragment_source.c_str());
+	add(reinterpret_cast< char const * >(glGetString(GL_VENDOR)));
+	add(reinterpret_cast< char const * >(glGetString(GL_RENDERER)));
+	add(reinterpret_cast< char const * >(glGetString(GL_VERSION)));
+	return h;
+}
+
+//create and return an OpenGL shader from source:
+GLuint compile_shader(GLenum type, std::string const &source) {
+	GLuint shader = glCreateShader(type);
+	GLchar const *str = source.c_str();
+	GLint length = GLint(source.size());
+	glShaderSource(shader, 1, &str, &length);
+	glCompileShader(shader);
+	GLint compile_status = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compile_status);
+	if (compile_status != GL_TRUE) {
+		std::cerr << "Failed to compile shader." << std::endl;
+		GLint info_log_length = 0;
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &info_log_length);
+		std::vector< GLchar > info_log(info_log_length, 0);
+		GLsizei length = 0;
+		glGetShaderInfoLog(shader, GLsizei(info_log.size()), &length, &info_log[0]);
+		std::cerr << "Info log: " << std::string(info_log.begin(), info_log.begin() + length);
+		glDeleteShader(shader);
+		throw std::runtime_error("Failed to compile shader.");
+	}
+	return shader;
+}
+
+//compile and link a program from source (throws on failure):
+GLuint link_program(std::string const &vertex_source, std::string const &fragment_source, bool retrievable) {
+	GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, vertex_source);
+	GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER, fragment_source);
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertex_shader);
+	glAttachShader(program, fragment_shader);
+	//shaders are reference counted so this makes sure they are freed after program is deleted:
+	glDeleteShader(vertex_shader);
+	glDeleteShader(fragment_shader);
+
+	if (retrievable) {
+		gl.ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+
+	//link the shader program and throw errors if linking fails:
+	glLinkProgram(program);
+	GLint link_status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+	if (link_status != GL_TRUE) {
+		std::cerr << "Failed to link shader program." << std::endl;
+		GLint info_log_length = 0;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &info_log_length);
+		std::vector< GLchar > info_log(info_log_length, 0);
+		GLsizei length = 0;
+		glGetProgramInfoLog(program, GLsizei(info_log.size()), &length, &info_log[0]);
+		std::cerr << "Info log: " << std::string(info_log.begin(), info_log.begin() + length);
+		throw std::runtime_error("failed to link program");
+	}
+	return program;
+}
+
+//a program made from a cached binary, or 0 if there is no usable one:
+GLuint load_binary(std::string const &filename, uint64_t key) {
+	std::ifstream in(filename, std::ios::binary);
+	if (!in) return 0;
+
+	std::vector< Header > headers;
+	std::vector< uint8_t > binary;
+	try {
+		read_chunk(in, "prh0", &headers);
+		if (headers.size() != 1 || headers[0].key != key) return 0; //(stale: sources or driver changed)
+		read_chunk(in, "prb0", &binary);
+	} catch (std::exception &) {
+		return 0; //(truncated or not a cache file)
+	}
+
+	GLuint program = glCreateProgram();
+	gl.ProgramBinary(program, headers[0].format, binary.data(), GLsizei(binary.size()));
+	GLint link_status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+	if (link_status != GL_TRUE) {
+		//(the driver may reject a binary for reasons the key doesn't capture)
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+//save 'program's binary (failing quietly -- the cache is only an optimization):
+void save_binary(std::string const &filename, uint64_t key, GLuint program) {
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) return;
+
+	std::vector< Header > headers(1);
+	headers[0].key = key;
+	std::vector< uint8_t > binary(length);
+	GLenum format = 0;
+	gl.GetProgramBinary(program, length, &length, &format, binary.data());
+	headers[0].format = format;
+	binary.resize(length);
+
+	//write to a temporary file first, so a crash (or another instance) never sees half a binary
+	// (named for this process, so instances launched together don't write into the same one):
+	#ifdef _WIN32
+	std::string temporary = filename + "." + std::to_string(_getpid()) + ".tmp";
+	#else
+	std::string temporary = filename + "." + std::to_string(getpid()) + ".tmp";
+	#endif
+	try {
+		std::ofstream out(temporary, std::ios::binary);
+		if (!out) return;
+		write_chunk("prh0", headers, &out);
+		write_chunk("prb0", binary, &out);
+	} catch (std::exception &) {
+		std::remove(temporary.c_str());
+		return;
+	}
+	std::remove(filename.c_str()); //(rename won't replace an existing file on windows)
+	if (std::rename(temporary.c_str(), filename.c_str()) != 0) {
+		std::remove(temporary.c_str()); //(e.g., another instance's rename got there first)
+	}
+}
+
+} //namespace
+
+GLuint load_program(std::string const &name, std::string const &vertex_source, std::string const &fragment_source) {
+	if (!binaries_supported()) {
+		return link_program(vertex_source, fragment_source, false);
+	}
+
+	std::string filename = user_path(name + ".program");
+	uint64_t key = program_key(vertex_source, fragment_source);
+
+	if (GLuint program = load_binary(filename, key)) return program;
+
+	GLuint program = link_program(vertex_source, fragment_source, true);
+	save_binary(filename, key, program);
+	return program;
+}
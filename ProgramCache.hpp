@@ -0,0 +1,23 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <string>
+
+// Linked shader programs, cached across runs. The first run compiles and links
+// from source as usual, then saves the driver's binary of the linked program
+// (glGetProgramBinary, from ARB_get_program_binary / GL 4.1) under user_path();
+// later runs hand that binary straight back to the driver (glProgramBinary)
+// and skip compiling and linking entirely.
+//
+// A cache file is only used if its key -- a hash of the shader sources and the
+// driver's vendor, renderer, and version strings -- matches, so editing a
+// shader or updating the driver just causes one more compile. The driver may
+// also reject a binary on its own; that falls back to compiling too.
+//
+//   GLuint program = load_program("simple_shading", vertex_source, fragment_source);
+//
+// Without program binary support (checked at runtime), this always compiles.
+
+//returns a linked program object named 'name' in the cache (throws if compiling or linking fails):
+GLuint load_program(std::string const &name, std::string const &vertex_source, std::string const &fragment_source);
@@ -0,0 +1,67 @@
+#include "Replay.hpp"
+
+#include "read_chunk.hpp" //helper for reading a vector of structures from a file
+#include "write_chunk.hpp" //helper for writing a vector of structures to a file
+
+#include <fstream>
+
+void Replay::finish(KitchenState const &state, uint32_t ticks) {
+	header.ticks = ticks;
+	header.rounds = state.rounds;
+	header.final_hash = hash(state);
+}
+
+KitchenState Replay::play() const {
+	KitchenState state(header.seed);
+	for (Event const &event : events) {
+		state.step(event.action());
+	}
+	return state;
+}
+
+bool Replay::matches(KitchenState const &state) const {
+	return state.rounds == header.rounds && hash(state) == header.final_hash;
+}
+
+uint32_t Replay::hash(KitchenState const &state) {
+	//FNV-1a over the masks and held food:
+	uint32_t h = 0x811c9dc5u;
+	auto add = [&h](uint32_t word) {
+		for (uint32_t i = 0; i < 4; ++i) {
+			h = (h ^ ((word >> (8 * i)) & 0xff)) * 0x01000193u;
+		}
+	};
+	for (uint32_t l = 0; l < KitchenState::LayerCount; ++l) {
+		add(state.masks[l]);
+	}
+	add(state.held);
+	return h;
+}
+
+void Replay::save(std::string const &filename) const {
+	std::ofstream out(filename, std::ios::binary);
+	if (!out) {
+		throw std::runtime_error("Failed to open replay '" + filename + "' for writing.");
+	}
+	write_chunk("rpl0", std::vector< Header >(1, header), &out);
+	write_chunk("act0", events, &out);
+}
+
+void Replay::load(std::string const &filename) {
+	std::ifstream in(filename, std::ios::binary);
+	if (!in) {
+		throw std::runtime_error("Failed to open replay '" + filename + "'.");
+	}
+	std::vector< Header > headers;
+	read_chunk(in, "rpl0", &headers);
+	if (headers.size() != 1) {
+		throw std::runtime_error("Replay '" + filename + "' should have exactly one header.");
+	}
+	header = headers[0];
+	read_chunk(in, "act0", &events);
+	for (size_t i = 1; i < events.size(); ++i) {
+		if (events[i].tick() < events[i-1].tick()) {
+			throw std::runtime_error("Replay '" + filename + "' has events out of order.");
+		}
+	}
+}
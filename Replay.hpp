@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Kitchen.hpp"
+
+#include <string>
+#include <vector>
+
+// A 'Replay' is a recording of a play session: the kitchen's random seed plus
+// every accepted action, tagged with the tick it happened on. Since the rules
+// and the random streams are deterministic, that is enough to reproduce the
+// session exactly, either rendered (Game) or headless at full speed (sim).
+//
+// On disk it is two chunks in the read_chunk framing:
+//   "rpl0" -- one Header
+//   "act0" -- Events, in order, four bytes each
+
+struct Replay {
+	struct Header {
+		uint64_t seed = 0; //KitchenState seed (stream 0)
+		uint32_t ticks = 0; //length of the session
+		uint32_t rounds = 0; //deliveries made by the end of the session
+		uint32_t final_hash = 0; //hash of the board at the end (see Replay::hash)
+		uint32_t tick_rate = 0; //ticks per second the session ran at (0 if unknown)
+	};
+	static_assert(sizeof(Header) == 24, "Replay::Header should be packed.");
+
+	struct Event {
+		uint32_t tick_action = 0; //tick << 2 | action
+
+		Event() = default;
+		Event(uint32_t tick, KitchenState::Action action) : tick_action((tick << 2) | action) { }
+
+		uint32_t tick() const { return tick_action >> 2; }
+		KitchenState::Action action() const { return KitchenState::Action(tick_action & 3); }
+	};
+	static_assert(sizeof(Event) == 4, "Replay::Event should be packed.");
+
+	//append an action taken on 'tick':
+	void record(uint32_t tick, KitchenState::Action action) {
+		events.emplace_back(tick, action);
+	}
+
+	//note how the session ended, so playback can check it ends the same way:
+	void finish(KitchenState const &state, uint32_t ticks);
+
+	//apply every action to a fresh kitchen and return the result (headless, ignores ticks):
+	KitchenState play() const;
+
+	//does 'state' match the end of the recorded session?
+	bool matches(KitchenState const &state) const;
+
+	//summary of a kitchen's board and progress:
+	static uint32_t hash(KitchenState const &state);
+
+	void save(std::string const &filename) const; //throws on failure
+	void load(std::string const &filename); //throws on failure
+
+	Header header;
+	std::vector< Event > events;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+// 'Rng' is a counter-based random number generator built on the SplitMix64
+// mixing function: the n-th output of a stream is mix(key + n * gamma), with
+// no hidden state beyond the counter. Streams are cheap (16 bytes), need no
+// warm-up, and are fully determined by (seed, stream), so every simulated game
+// can own one and get the same numbers no matter which thread plays it.
+
+struct Rng {
+	explicit Rng(uint64_t seed = 0, uint64_t stream = 0) : key(mix(seed + mix(stream + Gamma))) { }
+
+	//next 32 random bits:
+	uint32_t operator()() {
+		return uint32_t(next() >> 32);
+	}
+
+	//uniform-ish integer in [0, n) by multiply-shift (bias is below n / 2^32):
+	uint32_t below(uint32_t n) {
+		return uint32_t((uint64_t(operator()()) * n) >> 32);
+	}
+
+	uint64_t next() {
+		counter += 1;
+		return mix(key + counter * Gamma);
+	}
+
+	static uint64_t mix(uint64_t z) {
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+
+	static constexpr uint64_t Gamma = 0x9e3779b97f4a7c15ull; //2^64 / golden ratio
+
+	uint64_t key;
+	uint64_t counter = 0;
+};
@@ -0,0 +1,145 @@
+#include "Rollout.hpp"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+void Rollout::Stats::add(Stats const &other) {
+	rounds += other.rounds;
+	delivered += other.delivered;
+	steps += other.steps;
+	min_steps = std::min(min_steps, other.min_steps);
+	max_steps = std::max(max_steps, other.max_steps);
+	par += other.par;
+}
+
+void Rollout::play(uint64_t round, Stats *stats) const {
+	KitchenState state(seed, round);
+	Rng rng(Rng::mix(seed), round);
+	if (par) {
+		stats->par += par->moves(state);
+	}
+
+	uint64_t steps = 0;
+	bool delivered = false;
+	while (steps < max_steps && !delivered) {
+		delivered = (state.step(policy(state, rng)) == KitchenState::Delivered);
+		steps += 1;
+	}
+
+	stats->rounds += 1;
+	stats->steps += steps;
+	if (delivered) {
+		stats->delivered += 1;
+		stats->min_steps = std::min(stats->min_steps, steps);
+		stats->max_steps = std::max(stats->max_steps, steps);
+	}
+}
+
+//------- scheduler -------
+//Each worker owns a range of chunks [begin,end), packed as (begin << 32 | end) so that the
+//owner (taking chunks off the front) and thieves (taking the back half) can both claim work
+//with a single compare-and-swap. No new work is ever created, so a worker that finds every
+//range empty is done.
+
+namespace {
+	struct WorkRange {
+		std::atomic< uint64_t > range;
+		char padding[64 - sizeof(std::atomic< uint64_t >)]; //one range per cache line
+	};
+
+	inline uint64_t pack(uint32_t begin, uint32_t end) {
+		return (uint64_t(begin) << 32) | uint64_t(end);
+	}
+
+	//claim the first chunk of a range:
+	bool pop_front(WorkRange &work, uint32_t *chunk) {
+		uint64_t range = work.range.load(std::memory_order_relaxed);
+		while (true) {
+			uint32_t begin = uint32_t(range >> 32);
+			uint32_t end = uint32_t(range);
+			if (begin >= end) return false;
+			if (work.range.compare_exchange_weak(range, pack(begin + 1, end), std::memory_order_acq_rel, std::memory_order_relaxed)) {
+				*chunk = begin;
+				return true;
+			}
+		}
+	}
+
+	//claim the back half (rounded up) of a range:
+	bool steal_back(WorkRange &work, uint32_t *stolen_begin, uint32_t *stolen_end) {
+		uint64_t range = work.range.load(std::memory_order_relaxed);
+		while (true) {
+			uint32_t begin = uint32_t(range >> 32);
+			uint32_t end = uint32_t(range);
+			if (begin >= end) return false;
+			uint32_t mid = begin + (end - begin) / 2;
+			if (work.range.compare_exchange_weak(range, pack(begin, mid), std::memory_order_acq_rel, std::memory_order_relaxed)) {
+				*stolen_begin = mid;
+				*stolen_end = end;
+				return true;
+			}
+		}
+	}
+}
+
+Rollout::Stats Rollout::run(uint64_t rounds, uint32_t threads) const {
+	threads = std::max(threads, 1u);
+	uint64_t chunks = (rounds + chunk - 1) / chunk;
+
+	//deal chunks out evenly to start; stealing fixes any imbalance:
+	std::unique_ptr< WorkRange[] > work(new WorkRange[threads]);
+	for (uint32_t t = 0; t < threads; ++t) {
+		work[t].range.store(pack(uint32_t(chunks * t / threads), uint32_t(chunks * (t + 1) / threads)));
+	}
+
+	std::vector< Stats > results(threads);
+
+	auto worker = [&](uint32_t t) {
+		Stats stats; //thread-local until the end
+		Rng victims(t);
+		while (true) {
+			uint32_t c;
+			if (pop_front(work[t], &c)) {
+				uint64_t begin = uint64_t(c) * chunk;
+				uint64_t end = std::min(begin + chunk, rounds);
+				for (uint64_t r = begin; r < end; ++r) {
+					play(r, &stats);
+				}
+				continue;
+			}
+
+			//out of work; look for a victim, starting somewhere random:
+			bool stole = false;
+			uint32_t first = victims.below(threads);
+			for (uint32_t i = 0; i < threads && !stole; ++i) {
+				uint32_t v = (first + i) % threads;
+				uint32_t begin, end;
+				if (v != t && steal_back(work[v], &begin, &end)) {
+					//nobody steals from an empty range, so a plain store is safe:
+					work[t].range.store(pack(begin, end), std::memory_order_release);
+					stole = true;
+				}
+			}
+			if (!stole) break;
+		}
+		results[t] = stats;
+	};
+
+	std::vector< std::thread > helpers;
+	for (uint32_t t = 1; t < threads; ++t) {
+		helpers.emplace_back(worker, t);
+	}
+	worker(0);
+	for (auto &helper : helpers) {
+		helper.join();
+	}
+
+	Stats total;
+	for (auto const &stats : results) {
+		total.add(stats);
+	}
+	return total;
+}
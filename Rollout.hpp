@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Kitchen.hpp"
+#include "ParTable.hpp"
+
+#include <cstdint>
+
+// 'Rollout' plays many full rounds (fresh board through delivery) with a
+// policy, spread over worker threads by a work-stealing scheduler.
+//
+// Round i always draws from random stream i of the seed, so results do not
+// depend on the number of threads or on which thread ran it.
+
+struct Rollout {
+	//picks the next action; 'rng' is private to the round being played:
+	typedef KitchenState::Action (*Policy)(KitchenState const &state, Rng &rng);
+
+	//totals over some set of rounds:
+	struct Stats {
+		uint64_t rounds = 0; //rounds played (delivered or not)
+		uint64_t delivered = 0; //rounds that ended in a delivery
+		uint64_t steps = 0; //actions taken over all rounds
+		uint64_t min_steps = ~0ull; //fewest actions in a delivered round
+		uint64_t max_steps = 0; //most actions in a delivered round
+		uint64_t par = 0; //optimal actions over all rounds (if Rollout::par is set)
+
+		void add(Stats const &other);
+	};
+
+	Rollout(Policy policy_) : policy(policy_) { }
+
+	//play rounds [0, rounds) on 'threads' workers:
+	Stats run(uint64_t rounds, uint32_t threads) const;
+
+	//play a single round:
+	void play(uint64_t round, Stats *stats) const;
+
+	Policy policy;
+	uint64_t seed = 0; //round i uses stream i of this seed (and of mix(seed) for the policy)
+	uint32_t max_steps = 10000; //give up on a round after this many actions
+	uint32_t chunk = 512; //rounds per unit of work in the scheduler
+	ParTable const *par = nullptr; //if set, Stats::par sums the optimal move count of each round
+};
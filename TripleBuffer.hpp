@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// 'TripleBuffer' hands values from one writer thread to one reader thread
+// without locks or waiting: the writer fills the back buffer and publishes it,
+// the reader picks up the most recently published buffer whenever it likes.
+// Neither side ever touches the buffer the other is using, and buffers that
+// are published but never read are simply overwritten.
+//
+//   writer:  fill(buffer.back()); buffer.publish();
+//   reader:  buffer.acquire(); use(buffer.front());
+//
+// Buffers are reused, so a T that owns memory (e.g., std::vector) stops
+// allocating once it has grown to size.
+
+template< typename T >
+struct TripleBuffer {
+	//writer: the buffer to fill next
+	T &back() { return buffers[back_index]; }
+
+	//writer: make the back buffer the latest published value (and take the old middle buffer as the new back):
+	void publish() {
+		back_index = middle.exchange(uint8_t(back_index | Fresh), std::memory_order_acq_rel) & IndexMask;
+	}
+
+	//reader: has a value been published since the last acquire()?
+	bool fresh() const {
+		return (middle.load(std::memory_order_acquire) & Fresh) != 0;
+	}
+
+	//reader: if there is a newly published value, make it the front buffer; returns whether there was:
+	bool acquire() {
+		if (!fresh()) return false;
+		front_index = middle.exchange(front_index, std::memory_order_acq_rel) & IndexMask;
+		return true;
+	}
+
+	//reader: the most recently acquired value
+	T const &front() const { return buffers[front_index]; }
+
+private:
+	static const uint8_t IndexMask = 0x3;
+	static const uint8_t Fresh = 0x4; //set in 'middle' when it holds a value the reader hasn't seen
+
+	T buffers[3];
+	std::atomic< uint8_t > middle{1}; //index of the buffer between writer and reader (plus the Fresh bit)
+	uint8_t back_index = 0; //(writer only)
+	uint8_t front_index = 2; //(reader only)
+};
@@ -0,0 +1,255 @@
+//bench renders Undercooked offscreen (no window) for a fixed number of frames
+// while a scripted player moves the chef, and reports frame, update, and draw
+// time percentiles. It uses an EGL context with no surface (on Linux this works
+// on Mesa's software rasterizer, so it can run on headless machines) and draws
+// into a framebuffer object.
+//
+// usage: bench [--frames N] [--warmup N] [--seed S] [--size WxH] [--tick-rate HZ] [--script par|random]
+//  --script par presses the optimal key (from dist/par.blob) every tick; random presses a random arrow key
+// Results are printed as "name: value" lines (times in milliseconds).
+
+#include "Game.hpp"
+#include "GLDebug.hpp"
+#include "Profiler.hpp"
+#include "Rng.hpp"
+#include "GL.hpp"
+#include "gl_errors.hpp"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <SDL.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//value below which 'p' (in [0,1]) of the sorted samples fall (nearest rank):
+static double percentile(std::vector< double > const &sorted, double p) {
+	if (sorted.empty()) return 0.0;
+	size_t rank = size_t(std::ceil(p * sorted.size()));
+	return sorted[std::min(sorted.size(), std::max< size_t >(rank, 1)) - 1];
+}
+
+//the key that would cause 'action' in Game::handle_event:
+static SDL_Event key_event(KitchenState::Action action) {
+	SDL_Event evt;
+	std::memset(&evt, 0, sizeof(evt));
+	evt.type = SDL_KEYDOWN;
+	evt.key.repeat = 0;
+	if (action == KitchenState::Up) evt.key.keysym.scancode = SDL_SCANCODE_UP;
+	else if (action == KitchenState::Down) evt.key.keysym.scancode = SDL_SCANCODE_DOWN;
+	else if (action == KitchenState::Left) evt.key.keysym.scancode = SDL_SCANCODE_LEFT;
+	else evt.key.keysym.scancode = SDL_SCANCODE_RIGHT;
+	return evt;
+}
+
+//OpenGL 3.3 core context with no surface, made current on this thread:
+struct OffscreenContext {
+	OffscreenContext() {
+		//prefer the surfaceless platform (no X or Wayland needed), if the EGL implementation has it:
+		std::string client_extensions;
+		if (char const *extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS)) client_extensions = extensions;
+		if (client_extensions.find("EGL_MESA_platform_surfaceless") != std::string::npos) {
+			auto get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+			if (get_platform_display) display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+		}
+		if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) {
+			throw std::runtime_error("Failed to initialize an EGL display.");
+		}
+		if (!eglBindAPI(EGL_OPENGL_API)) {
+			throw std::runtime_error("EGL display does not support desktop OpenGL.");
+		}
+
+		EGLint const config_attribs[] = {
+			EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_NONE
+		};
+		EGLConfig config;
+		EGLint configs = 0;
+		if (!eglChooseConfig(display, config_attribs, &config, 1, &configs) || configs == 0) {
+			//(surfaceless displays may have no pbuffer-capable configs; the context doesn't need one)
+			EGLint const any_attribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+			if (!eglChooseConfig(display, any_attribs, &config, 1, &configs) || configs == 0) {
+				throw std::runtime_error("No EGL config supports desktop OpenGL.");
+			}
+		}
+
+		EGLint const context_attribs[] = {
+			EGL_CONTEXT_MAJOR_VERSION, 3,
+			EGL_CONTEXT_MINOR_VERSION, 3,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+		context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+		if (context == EGL_NO_CONTEXT) {
+			throw std::runtime_error("Failed to create an OpenGL 3.3 core context with EGL.");
+		}
+		if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+			throw std::runtime_error("Failed to make the EGL context current without a surface.");
+		}
+	}
+	~OffscreenContext() {
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (context != EGL_NO_CONTEXT) eglDestroyContext(display, context);
+		eglTerminate(display);
+	}
+	EGLDisplay display = EGL_NO_DISPLAY;
+	EGLContext context = EGL_NO_CONTEXT;
+};
+
+int main(int argc, char **argv) {
+	struct {
+		uint32_t frames = 1000;
+		uint32_t warmup = 60; //frames drawn (and not measured) first, so shader compiles and buffer growth don't count
+		uint64_t seed = 0;
+		glm::uvec2 size = glm::uvec2(640, 400);
+		uint32_t tick_rate = 60; //simulation ticks per frame is fixed at one; this only sets the tick length
+		bool par_script = true;
+	} config;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--frames" && i + 1 < argc) {
+			config.frames = std::max(1u, uint32_t(std::strtoul(argv[++i], nullptr, 10)));
+		} else if (arg == "--warmup" && i + 1 < argc) {
+			config.warmup = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+		} else if (arg == "--seed" && i + 1 < argc) {
+			config.seed = std::strtoull(argv[++i], nullptr, 10);
+		} else if (arg == "--size" && i + 1 < argc) {
+			unsigned w = 0, h = 0;
+			if (std::sscanf(argv[++i], "%ux%u", &w, &h) != 2 || w == 0 || h == 0) {
+				std::cerr << "Expecting --size WxH, e.g. --size 1280x720." << std::endl;
+				return 1;
+			}
+			config.size = glm::uvec2(w, h);
+		} else if (arg == "--tick-rate" && i + 1 < argc) {
+			config.tick_rate = std::max(1u, uint32_t(std::strtoul(argv[++i], nullptr, 10)));
+		} else if (arg == "--script" && i + 1 < argc && (std::string(argv[i+1]) == "par" || std::string(argv[i+1]) == "random")) {
+			config.par_script = (std::string(argv[++i]) == "par");
+		} else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--frames N] [--warmup N] [--seed S] [--size WxH] [--tick-rate HZ] [--script par|random]" << std::endl;
+			return 1;
+		}
+	}
+
+	profile_name_thread("main");
+
+	OffscreenContext context;
+
+	#ifndef NDEBUG
+	gl_debug_start([](char const *name) { return (void *)eglGetProcAddress(name); });
+	#endif
+
+	//render target (stands in for the window's default framebuffer):
+	GLuint color_rb = 0, depth_rb = 0, fb = 0;
+	glGenRenderbuffers(1, &color_rb);
+	glBindRenderbuffer(GL_RENDERBUFFER, color_rb);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, config.size.x, config.size.y);
+	glGenRenderbuffers(1, &depth_rb);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth_rb);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, config.size.x, config.size.y);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &fb);
+	glBindFramebuffer(GL_FRAMEBUFFER, fb);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_rb);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth_rb);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cerr << "Offscreen framebuffer is incomplete." << std::endl;
+		return 1;
+	}
+	glViewport(0, 0, config.size.x, config.size.y);
+	GL_ERRORS();
+
+	std::cout << "renderer: " << (char const *)glGetString(GL_RENDERER) << "\n";
+	std::cout << "version: " << (char const *)glGetString(GL_VERSION) << "\n";
+
+	{ //(Game frees its OpenGL resources before the context goes away)
+		Game game;
+		game.reset(config.seed); //(same kitchen every run)
+		Rng rng(config.seed, 1);
+
+		float const tick_length = 1.0f / float(config.tick_rate);
+		Game::Snapshot snapshot;
+
+		std::vector< double > frame_ms, update_ms, draw_ms;
+		frame_ms.reserve(config.frames);
+		update_ms.reserve(config.frames);
+		draw_ms.reserve(config.frames);
+
+		typedef std::chrono::high_resolution_clock Clock;
+		auto ms = [](Clock::time_point a, Clock::time_point b) {
+			return std::chrono::duration< double, std::milli >(b - a).count();
+		};
+
+		//(Game reports each delivery on std::cout; keep the output to just the results)
+		std::streambuf *cout_buffer = std::cout.rdbuf(nullptr);
+
+		for (uint32_t frame = 0; frame < config.warmup + config.frames; ++frame) {
+			PROFILE_ZONE("frame");
+			auto before = Clock::now();
+
+			//scripted input -- one key press per tick, through the same path as the keyboard:
+			KitchenState::Action action = (config.par_script
+				? game.par_table.first_action(game.kitchen)
+				: KitchenState::Action(rng.below(4)));
+			game.handle_event(key_event(action), config.size);
+
+			game.update(tick_length);
+			game.snapshot(&snapshot);
+			auto updated = Clock::now();
+
+			glClearColor(0.5, 0.5, 0.5, 0.0);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			glEnable(GL_DEPTH_TEST);
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+			//draw halfway between ticks, so the interpolation path is exercised:
+			game.draw(config.size, snapshot, 0.5f);
+			glFinish(); //(there is no swap to wait on, so wait for the GPU to be done instead)
+			auto drawn = Clock::now();
+
+			if (frame < config.warmup) continue;
+			frame_ms.emplace_back(ms(before, drawn));
+			update_ms.emplace_back(ms(before, updated));
+			draw_ms.emplace_back(ms(updated, drawn));
+		}
+		std::cout.rdbuf(cout_buffer);
+		std::cout.clear();
+		GL_ERRORS();
+		gl_debug_flush(std::cerr);
+
+		std::cout << "size: " << config.size.x << "x" << config.size.y << "\n";
+		std::cout << "frames: " << config.frames << "\n";
+		std::cout << "rounds: " << game.kitchen.rounds << "\n";
+		auto report = [](char const *name, std::vector< double > &samples) {
+			std::sort(samples.begin(), samples.end());
+			std::cout << name << " p50: " << percentile(samples, 0.50) << "\n";
+			std::cout << name << " p95: " << percentile(samples, 0.95) << "\n";
+			std::cout << name << " p99: " << percentile(samples, 0.99) << "\n";
+		};
+		report("frame_ms", frame_ms);
+		report("update_ms", update_ms);
+		report("draw_ms", draw_ms);
+		std::cout.flush();
+	}
+
+	glDeleteFramebuffers(1, &fb);
+	glDeleteRenderbuffers(1, &depth_rb);
+	glDeleteRenderbuffers(1, &color_rb);
+
+	return 0;
+}
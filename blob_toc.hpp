@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+// Blobs with a table of contents ("packs") start with a header and a list of
+// their chunks, so a reader can go straight to the chunks it wants -- in any
+// order -- and skip ones it doesn't know:
+//
+//   BlobHeader
+//   BlobTocEntry x header.chunk_count
+//   chunk data, each chunk at its entry's offset (zero padding in between)
+//
+// Chunk data is what would follow the eight-byte header in the read_chunk
+// framing; a compressed chunk (see compressed_chunk.hpp) is marked the same
+// way, by the high bit of the first character of its magic.
+//
+// Checksums are CRC-32C (crc32c.hpp) of the chunk data as stored (i.e., of
+// the compressed bytes for a compressed chunk). Blob reads these files, and
+// BlobWriter (write_blob.hpp) writes them.
+//
+// Files without the header -- chunks back to back, as write_chunk writes
+// them -- still load, but have no checksums.
+
+//"BLOB", the first four bytes of a pack:
+const char BlobHeaderMagic[4] = {'B', 'L', 'O', 'B'};
+const uint32_t BlobVersion = 1;
+
+struct BlobHeader {
+	char magic[4]; //BlobHeaderMagic
+	uint32_t version; //BlobVersion; readers refuse other versions
+	uint32_t chunk_count;
+	uint32_t toc_checksum; //crc32c of the chunk_count entries that follow
+};
+static_assert(sizeof(BlobHeader) == 16, "BlobHeader should be packed.");
+
+struct BlobTocEntry {
+	char magic[4]; //(high bit of the first character set if compressed)
+	uint32_t reserved; //(zero)
+	uint64_t offset; //from the start of the file
+	uint64_t size; //bytes of data as stored
+	uint32_t alignment; //power of two that offset is a multiple of
+	uint32_t checksum; //crc32c of the data as stored
+};
+static_assert(sizeof(BlobTocEntry) == 32, "BlobTocEntry should be packed.");
@@ -0,0 +1,137 @@
+#include "compressed_chunk.hpp"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace {
+
+//the fixed part of the data, before the block sizes:
+struct Header {
+	uint32_t inflated_size;
+	uint32_t block_size;
+};
+static_assert(sizeof(Header) == 8, "Header should be packed.");
+
+//where each block is, checked against 'size':
+struct Layout {
+	Header header;
+	uint32_t blocks = 0;
+	uint8_t const *compressed_sizes = nullptr; //uint32 each (may be unaligned, so read with memcpy)
+	uint8_t const *first_block = nullptr;
+};
+
+Layout layout(uint8_t const *data, size_t size) {
+	Layout ret;
+	if (size < sizeof(Header)) {
+		throw std::runtime_error("Compressed chunk is too short for its header.");
+	}
+	std::memcpy(&ret.header, data, sizeof(Header));
+	if (ret.header.inflated_size != 0 && ret.header.block_size == 0) {
+		throw std::runtime_error("Compressed chunk has zero-size blocks.");
+	}
+	if (ret.header.inflated_size / 1032 > size) { //(deflate never expands more than 1032:1, so this is corrupt, and would be a needlessly huge allocation)
+		throw std::runtime_error("Compressed chunk claims an impossible uncompressed size.");
+	}
+	ret.blocks = (ret.header.inflated_size == 0 ? 0 : (ret.header.inflated_size - 1) / ret.header.block_size + 1);
+	if ((size - sizeof(Header)) / 4 < ret.blocks) {
+		throw std::runtime_error("Compressed chunk is too short for its block table.");
+	}
+	ret.compressed_sizes = data + sizeof(Header);
+	ret.first_block = data + sizeof(Header) + 4 * size_t(ret.blocks);
+	return ret;
+}
+
+} //namespace
+
+std::vector< uint8_t > compress_chunk_data(void const *data_, size_t size, uint32_t block_size) {
+	uint8_t const *data = reinterpret_cast< uint8_t const * >(data_);
+	if (size > 0xffffffffu) {
+		throw std::runtime_error("Chunk is too large to compress.");
+	}
+	Header header;
+	header.inflated_size = uint32_t(size);
+	header.block_size = std::max(block_size, 1u);
+	uint32_t blocks = (size == 0 ? 0 : uint32_t((size - 1) / header.block_size + 1));
+
+	std::vector< uint32_t > compressed_sizes(blocks);
+	std::vector< uint8_t > compressed;
+	for (uint32_t b = 0; b < blocks; ++b) {
+		size_t begin = size_t(b) * header.block_size;
+		uLong length = uLong(std::min< size_t >(header.block_size, size - begin));
+		uLongf bound = compressBound(length);
+		size_t at = compressed.size();
+		compressed.resize(at + bound);
+		if (compress2(compressed.data() + at, &bound, data + begin, length, Z_BEST_COMPRESSION) != Z_OK) {
+			throw std::runtime_error("Failed to compress chunk.");
+		}
+		compressed.resize(at + bound);
+		compressed_sizes[b] = uint32_t(bound);
+	}
+
+	std::vector< uint8_t > ret(sizeof(Header) + 4 * compressed_sizes.size() + compressed.size());
+	std::memcpy(ret.data(), &header, sizeof(Header));
+	if (blocks) std::memcpy(ret.data() + sizeof(Header), compressed_sizes.data(), 4 * compressed_sizes.size());
+	if (!compressed.empty()) std::memcpy(ret.data() + sizeof(Header) + 4 * compressed_sizes.size(), compressed.data(), compressed.size());
+	return ret;
+}
+
+size_t inflated_chunk_size(uint8_t const *data, size_t size) {
+	return layout(data, size).header.inflated_size;
+}
+
+void inflate_chunk_data(uint8_t const *data, size_t size, uint8_t *out) {
+	Layout l = layout(data, size);
+
+	//find every block's start up front (and check they all fit), so blocks can be inflated in any order:
+	std::vector< size_t > starts(l.blocks + 1);
+	starts[0] = size_t(l.first_block - data);
+	for (uint32_t b = 0; b < l.blocks; ++b) {
+		uint32_t compressed_size;
+		std::memcpy(&compressed_size, l.compressed_sizes + 4 * size_t(b), 4);
+		if (size - starts[b] < compressed_size) {
+			throw std::runtime_error("Compressed chunk is shorter than its blocks.");
+		}
+		starts[b + 1] = starts[b] + compressed_size;
+	}
+	if (starts[l.blocks] != size) {
+		throw std::runtime_error("Compressed chunk has data after its blocks.");
+	}
+
+	//inflate block 'b', returning false if it is corrupt:
+	auto inflate_block = [&](uint32_t b) -> bool {
+		size_t begin = size_t(b) * l.header.block_size;
+		uLongf length = uLongf(std::min< size_t >(l.header.block_size, l.header.inflated_size - begin));
+		uLongf expected = length;
+		int result = uncompress(out + begin, &length, data + starts[b], uLong(starts[b + 1] - starts[b]));
+		return result == Z_OK && length == expected;
+	};
+
+	//blocks are handed out one at a time to this thread and (if there are enough blocks) some helpers:
+	std::atomic< uint32_t > next(0);
+	std::atomic< bool > corrupt(false);
+	auto work = [&]() {
+		for (uint32_t b = next++; b < l.blocks; b = next++) {
+			if (!inflate_block(b)) corrupt = true;
+		}
+	};
+
+	uint32_t threads = std::min(l.blocks, std::max(1u, std::thread::hardware_concurrency()));
+	std::vector< std::thread > helpers;
+	for (uint32_t t = 1; t < threads; ++t) {
+		helpers.emplace_back(work);
+	}
+	work();
+	for (auto &helper : helpers) {
+		helper.join();
+	}
+
+	if (corrupt) {
+		throw std::runtime_error("Compressed chunk is corrupt.");
+	}
+}
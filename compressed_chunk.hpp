@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Compressed chunks use the same framing as read_chunk/write_chunk -- four
+// character magic, uint32 size, data -- but the first character of the magic
+// has its high bit set (so "par0" becomes "\xf0ar0"), and the data is:
+//
+//   uint32 uncompressed size
+//   uint32 block size (uncompressed bytes per block; the last block may be shorter)
+//   uint32 compressed size of each block
+//   the blocks, back to back, each an independent zlib stream
+//
+// Because the blocks don't depend on each other, big chunks inflate on several
+// threads at once. read_chunk and Blob accept either form wherever a chunk is
+// expected; write_compressed_chunk (write_chunk.hpp) writes this one.
+
+//the high bit of a compressed chunk's first magic character:
+const uint8_t CompressedMagicFlag = 0x80;
+
+//deflate 'size' bytes into compressed chunk data (everything after the chunk header):
+std::vector< uint8_t > compress_chunk_data(void const *data, size_t size, uint32_t block_size = 128 * 1024);
+
+//uncompressed size of compressed chunk data (throws if the data is too short to say):
+size_t inflated_chunk_size(uint8_t const *data, size_t size);
+
+//inflate compressed chunk data into 'out' (of inflated_chunk_size bytes), in parallel when there
+// are several blocks; throws if the data is corrupt:
+void inflate_chunk_data(uint8_t const *data, size_t size, uint8_t *out);
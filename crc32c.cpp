@@ -0,0 +1,94 @@
+#include "crc32c.hpp"
+
+#include <array>
+#include <cstring>
+
+//the SSE4.2 crc32 instruction computes exactly this crc; it is compiled whenever the target is x86, and used if the CPU has it:
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CRC32C_X86 1
+#include <nmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TARGET_SSE42
+#else
+#define TARGET_SSE42 __attribute__((target("sse4.2")))
+#endif
+#endif
+
+namespace {
+
+//crc of each byte value, for the byte-at-a-time loop:
+std::array< uint32_t, 256 > const &crc32c_table() {
+	static std::array< uint32_t, 256 > const table = [](){
+		std::array< uint32_t, 256 > ret;
+		for (uint32_t i = 0; i < 256; ++i) {
+			uint32_t crc = i;
+			for (uint32_t bit = 0; bit < 8; ++bit) {
+				crc = (crc >> 1) ^ (0x82f63b78u & (0u - (crc & 1u))); //(0x82f63b78 is the reflected polynomial)
+			}
+			ret[i] = crc;
+		}
+		return ret;
+	}();
+	return table;
+}
+
+//(these take and return the crc register, i.e., without the initial and final inversion)
+uint32_t crc32c_table_driven(uint8_t const *data, size_t size, uint32_t crc) {
+	std::array< uint32_t, 256 > const &table = crc32c_table();
+	for (size_t i = 0; i < size; ++i) {
+		crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	}
+	return crc;
+}
+
+#ifdef CRC32C_X86
+TARGET_SSE42 uint32_t crc32c_sse42(uint8_t const *data, size_t size, uint32_t crc) {
+	#if defined(__x86_64__) || defined(_M_X64)
+	uint64_t crc64 = crc;
+	for (; size >= 8; data += 8, size -= 8) {
+		uint64_t word;
+		std::memcpy(&word, data, 8); //(data may not be aligned)
+		crc64 = _mm_crc32_u64(crc64, word);
+	}
+	crc = uint32_t(crc64);
+	#else
+	for (; size >= 4; data += 4, size -= 4) {
+		uint32_t word;
+		std::memcpy(&word, data, 4);
+		crc = _mm_crc32_u32(crc, word);
+	}
+	#endif
+	for (; size > 0; ++data, --size) {
+		crc = _mm_crc32_u8(crc, *data);
+	}
+	return crc;
+}
+
+bool cpu_has_sse42() {
+	#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	return (info[2] & (1 << 20)) != 0;
+	#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse4.2");
+	#endif
+}
+#endif
+
+//the fastest implementation this CPU supports:
+typedef uint32_t (*Crc32cFunction)(uint8_t const *, size_t, uint32_t);
+Crc32cFunction best_crc32c() {
+	#ifdef CRC32C_X86
+	if (cpu_has_sse42()) return crc32c_sse42;
+	#endif
+	return crc32c_table_driven;
+}
+
+} //namespace
+
+uint32_t crc32c(void const *data, size_t size, uint32_t crc) {
+	static Crc32cFunction const function = best_crc32c();
+	return ~function(reinterpret_cast< uint8_t const * >(data), size, ~crc);
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//CRC-32C (Castagnoli polynomial, as in iSCSI and ext4) of 'size' bytes, using SSE4.2's crc32 instruction when the CPU has it;
+// pass a previous result as 'crc' to continue it, so crc32c(b, n, crc32c(a, m)) is the crc of a followed by b:
+uint32_t crc32c(void const *data, size_t size, uint32_t crc = 0);
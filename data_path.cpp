@@ -3,6 +3,7 @@
 #include <iostream>
 #include <vector>
 #include <sstream>
+#include <cstdlib>
 
 #if defined(_WIN32)
 #include <windows.h>
@@ -12,6 +13,7 @@
 #include <io.h>
 #elif defined(__APPLE__)
 #include <mach-o/dyld.h>
+#include <sys/stat.h>
 #elif defined(__linux__)
 #include <unistd.h>
 #include <sys/stat.h>
@@ -71,3 +73,57 @@ std::string data_path(std::string const &suffix) {
 	static std::string path = get_data_path();
 	return path + "/" + suffix;
 }
+
+//get_user_path() finds (and creates, if needed) a per-user directory for the game's files:
+//  Windows: %LOCALAPPDATA%\Undercooked
+//  MacOS: ~/Library/Application Support/Undercooked
+//  Linux: $XDG_DATA_HOME/undercooked (default ~/.local/share/undercooked)
+// ...or falls back to the data path if there is no such place.
+
+static std::string get_user_path() {
+	#if defined(_WIN32)
+	PWSTR folder = NULL;
+	std::string ret;
+	if (SHGetKnownFolderPath(FOLDERID_LocalAppData, 0, NULL, &folder) == S_OK) {
+		char buffer[MAX_PATH];
+		if (WideCharToMultiByte(CP_UTF8, 0, folder, -1, buffer, MAX_PATH, NULL, NULL) > 0) {
+			ret = std::string(buffer) + "\\Undercooked";
+		}
+	}
+	CoTaskMemFree(folder);
+	if (ret.empty()) return get_data_path();
+	_mkdir(ret.c_str()); //(fails harmlessly if it exists)
+	return ret;
+
+	#elif defined(__linux__) || defined(__APPLE__)
+	//make each directory along 'path' (mkdir -p):
+	auto make_directories = [](std::string const &path) {
+		for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1)) {
+			mkdir(path.substr(0, slash).c_str(), 0755); //(fails harmlessly if it exists)
+			if (slash == std::string::npos) break;
+		}
+		struct stat info;
+		return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+	};
+
+	std::string ret;
+	char const *home = std::getenv("HOME");
+	#if defined(__APPLE__)
+	if (home && home[0]) ret = std::string(home) + "/Library/Application Support/Undercooked";
+	#else
+	char const *xdg_data_home = std::getenv("XDG_DATA_HOME");
+	if (xdg_data_home && xdg_data_home[0] == '/') ret = std::string(xdg_data_home) + "/undercooked";
+	else if (home && home[0]) ret = std::string(home) + "/.local/share/undercooked";
+	#endif
+	if (ret.empty() || !make_directories(ret)) return get_data_path();
+	return ret;
+
+	#else
+	#error "No idea what the OS is."
+	#endif
+}
+
+std::string user_path(std::string const &suffix) {
+	static std::string path = get_user_path();
+	return path + "/" + suffix;
+}
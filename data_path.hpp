@@ -9,6 +9,6 @@
 std::string data_path(std::string const &suffix);
 
 //user_path returns an OS-specific location for writing/reading user data.
-// use data_path for save games and config files.
+// use user_path for save games, config files, and caches.
 // std::ofstream config(user_path("game.save"));
 std::string user_path(std::string const &suffix);
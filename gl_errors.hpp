@@ -1,6 +1,7 @@
 #pragma once
 
 #include "GL.hpp"
+#include "GLDebug.hpp"
 #include <iostream>
 #include <string>
 
@@ -28,5 +29,13 @@ inline void gl_errors(std::string const &where) {
 		#undef CHECK
 	}
 }
-#define GL_ERRORS() gl_errors(__FILE__  ":" STR(__LINE__) )
+
+//GL_ERRORS() reports errors since the last call; glGetError waits for the GPU to catch up, so
+// it is skipped when gl_debug_start() installed a callback (which reports the same errors
+// without waiting), and compiled out entirely in release (NDEBUG) builds:
+#ifdef NDEBUG
+#define GL_ERRORS() do { } while (0)
+#else
+#define GL_ERRORS() do { if (!gl_debug_active()) gl_errors(__FILE__  ":" STR(__LINE__) ); } while (0)
+#endif
 
@@ -1,6 +1,15 @@
 //Game.hpp declares the "game" object, which handles game-specific stuff:
 #include "Game.hpp"
 
+//GLDebug.hpp collects OpenGL debug messages without stalling:
+#include "GLDebug.hpp"
+
+//Profiler.hpp records PROFILE_ZONEs for trace export:
+#include "Profiler.hpp"
+
+//TripleBuffer.hpp hands frames to the drawing code without locks:
+#include "TripleBuffer.hpp"
+
 //GL.hpp will include a non-namespace-polluting set of opengl prototypes:
 #include "GL.hpp"
 
@@ -13,26 +22,94 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 //...and for c++ standard library functions:
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <iostream>
 #include <stdexcept>
 #include <fstream>
+#include <future>
 #include <memory>
 #include <algorithm>
+#include <cstdlib>
+#include <utility>
+#include <vector>
 
 int main(int argc, char **argv) {
+	std::chrono::steady_clock::time_point const launched = std::chrono::steady_clock::now();
+
 	struct {
 		//TODO: this is where you set the title and size of your game window
 		std::string title = "Undercooked";
 		glm::uvec2 size = glm::uvec2(640, 400);
+		std::string record; //if set, save a replay of the session here on exit
+		std::string playback; //if set, play this replay instead of taking keyboard input
+		uint32_t tick_rate = 60; //simulation ticks per second (independent of display rate)
+		bool redraw_on_change = false; //if set, only draw (and swap) when something changed; sleep otherwise
+		bool render_thread = false; //if set, draw on a separate thread (which owns the OpenGL context)
+		bool gpu_times = false; //if set, time the GPU passes of each frame and report them periodically
+		std::string trace = "trace.json"; //where F9 (or exiting, with --trace) writes a Chrome trace of recent zones
+		bool trace_on_exit = false;
+		float trace_seconds = 10.0f; //how far back traces go
+		bool startup_times = false; //if set, report how long each phase of startup took once the first frame is shown
 	} config;
 
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--record" && i + 1 < argc) {
+			config.record = argv[++i];
+		} else if (arg == "--playback" && i + 1 < argc) {
+			config.playback = argv[++i];
+		} else if (arg == "--redraw" && i + 1 < argc && (std::string(argv[i+1]) == "always" || std::string(argv[i+1]) == "on-change")) {
+			config.redraw_on_change = (std::string(argv[++i]) == "on-change");
+		} else if (arg == "--render-thread") {
+			config.render_thread = true;
+		} else if (arg == "--gpu-times") {
+			config.gpu_times = true;
+		} else if (arg == "--trace" && i + 1 < argc) {
+			config.trace = argv[++i];
+			config.trace_on_exit = true;
+		} else if (arg == "--trace-seconds" && i + 1 < argc) {
+			config.trace_seconds = std::max(0.1f, float(std::atof(argv[++i])));
+		} else if (arg == "--startup-times") {
+			config.startup_times = true;
+		} else if (arg == "--tick-rate" && i + 1 < argc) {
+			config.tick_rate = std::max(1u, uint32_t(std::strtoul(argv[++i], nullptr, 10)));
+		} else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--record <replay>] [--playback <replay>] [--tick-rate <hz>] [--redraw always|on-change] [--render-thread] [--gpu-times] [--trace <trace.json>] [--trace-seconds <s>] [--startup-times]" << std::endl;
+			return 1;
+		}
+	}
+
 	//------------  initialization ------------
 
+	profile_name_thread("main");
+
+	//startup phases on the main thread, as (name, seconds since launch when the phase finished):
+	std::vector< std::pair< char const *, float > > startup_phases;
+	auto startup_phase_done = [&](char const *name) {
+		startup_phases.emplace_back(name, std::chrono::duration< float >(std::chrono::steady_clock::now() - launched).count());
+	};
+
+	//Read and validate the assets on a worker thread while SDL brings up the window and context
+	// (nothing in Game::Assets needs OpenGL; the uploads happen in Game's constructor, below):
+	float assets_began = 0.0f, assets_finished = 0.0f; //(seconds since launch; written by the worker, read after get())
+	std::future< std::unique_ptr< Game::Assets > > assets_loading = std::async(std::launch::async, [&]() {
+		profile_name_thread("assets");
+		assets_began = std::chrono::duration< float >(std::chrono::steady_clock::now() - launched).count();
+		std::unique_ptr< Game::Assets > assets(new Game::Assets());
+		assets_finished = std::chrono::duration< float >(std::chrono::steady_clock::now() - launched).count();
+		return assets;
+	});
+
 	//Initialize SDL library:
 	SDL_Init(SDL_INIT_VIDEO);
+	startup_phase_done("SDL_Init");
 
-	//Ask for an OpenGL context version 3.3, core profile, enable debug:
+	//Ask for an OpenGL context version 3.3, core profile, enable debug (except in release builds):
 	SDL_GL_ResetAttributes();
 	SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
 	SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
@@ -42,7 +119,9 @@ int main(int argc, char **argv) {
 	SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
 	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+	#ifndef NDEBUG
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
+	#endif
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
 
@@ -61,6 +140,7 @@ int main(int argc, char **argv) {
 		std::cerr << "Error creating SDL window: " << SDL_GetError() << std::endl;
 		return 1;
 	}
+	startup_phase_done("create window");
 
 	//Create OpenGL context:
 	SDL_GLContext context = SDL_GL_CreateContext(window);
@@ -75,6 +155,14 @@ int main(int argc, char **argv) {
 	//On windows, load OpenGL extensions:
 	init_gl_shims();
 	#endif
+	startup_phase_done("create context");
+
+	#ifndef NDEBUG
+	//Report OpenGL errors through a debug callback (instead of glGetError, which stalls), if supported:
+	if (!gl_debug_start(SDL_GL_GetProcAddress)) {
+		std::cerr << "NOTE: no KHR_debug; GL_ERRORS() will poll glGetError." << std::endl;
+	}
+	#endif
 
 	//Set VSYNC + Late Swap (prevents crazy FPS):
 	if (SDL_GL_SetSwapInterval(-1) != 0) {
@@ -88,9 +176,35 @@ int main(int argc, char **argv) {
 	//SDL_ShowCursor(SDL_DISABLE);
 
 
-	//------------ create game object (loads assets) --------------
+	//------------ create game object (uploads assets) --------------
 
-	std::shared_ptr< Game > game = std::make_shared< Game >();
+	std::unique_ptr< Game::Assets > assets = assets_loading.get(); //(rethrows anything the worker threw)
+	startup_phase_done("wait for assets");
+	std::shared_ptr< Game > game = std::make_shared< Game >(*assets);
+	assets.reset(); //(the meshes are on the GPU now, so the mapping can go)
+	startup_phase_done("create game");
+
+	if (config.gpu_times) {
+		//(there is no HUD yet; when there is, it should get its own pass)
+		game->gpu_timers.reset(new GPUTimers({"frame", "tiles", "items"}));
+	}
+
+	//------------ replays --------------
+
+	Replay playback;
+	if (!config.playback.empty()) {
+		playback.load(config.playback);
+		game->play(&playback);
+		//play back at the rate the session was recorded at:
+		if (playback.header.tick_rate) config.tick_rate = playback.header.tick_rate;
+	}
+
+	Replay recording;
+	if (!config.record.empty()) {
+		recording.header.seed = game->seed;
+		recording.header.tick_rate = config.tick_rate;
+		game->recording = &recording;
+	}
 
 	//------------ main loop ------------
 
@@ -106,10 +220,128 @@ int main(int argc, char **argv) {
 		window_size = glm::uvec2(w, h);
 		SDL_GL_GetDrawableSize(window, &w, &h);
 		drawable_size = glm::uvec2(w, h);
-		glViewport(0, 0, drawable_size.x, drawable_size.y);
+		//(the viewport is set by draw_frame, on whichever thread does the drawing)
 	};
 	on_resize();
 
+	//the simulation advances in fixed ticks; leftover time carries over to the next frame:
+	float const tick_length = 1.0f / float(config.tick_rate);
+	float accumulator = 0.0f; //time not yet simulated
+
+	//the state to draw is handed over as a snapshot through a triple buffer, so that
+	// (with --render-thread) neither the main thread nor the render thread ever waits on the other:
+	struct Frame {
+		Game::Snapshot game;
+		glm::uvec2 drawable_size = glm::uvec2(0);
+		float alpha = 0.0f; //fraction of a tick in the accumulator when the frame was published
+		std::chrono::steady_clock::time_point published;
+		bool animating = false; //is motion still being interpolated (so it is worth drawing again without a new frame)?
+	};
+	TripleBuffer< Frame > frames;
+
+	//(main thread) hand the current state to the drawing code:
+	auto publish = [&]() {
+		PROFILE_ZONE("publish");
+		Frame &frame = frames.back();
+		game->snapshot(&frame.game);
+		frame.drawable_size = drawable_size;
+		frame.alpha = accumulator / tick_length;
+		frame.published = std::chrono::steady_clock::now();
+		frame.animating = game->animating();
+		frames.publish();
+		game->dirty = false;
+	};
+
+	//(thread with the OpenGL context, once) print the startup phases:
+	bool first_frame_shown = false;
+	auto report_startup = [&]() {
+		std::cout << "Startup (ms): phase / finished at\n";
+		float previous = 0.0f;
+		for (auto const &phase : startup_phases) {
+			std::cout << "  " << phase.first << ": " << (phase.second - previous) * 1000.0f << " / " << phase.second * 1000.0f << "\n";
+			previous = phase.second;
+		}
+		std::cout << "  (assets, on a worker thread: " << (assets_finished - assets_began) * 1000.0f << " / " << assets_finished * 1000.0f << ")\n";
+		std::cout << "Time to first frame: " << previous * 1000.0f << " ms" << std::endl;
+	};
+
+	//(thread with the OpenGL context) draw the most recently published frame:
+	glm::uvec2 viewport_size = glm::uvec2(0);
+	auto draw_frame = [&]() {
+		PROFILE_ZONE("draw_frame");
+		frames.acquire();
+		Frame const &frame = frames.front();
+		if (frame.drawable_size != viewport_size) {
+			viewport_size = frame.drawable_size;
+			glViewport(0, 0, viewport_size.x, viewport_size.y);
+		}
+
+		//interpolation keeps advancing with the time since the frame was published:
+		float since = std::chrono::duration< float >(std::chrono::steady_clock::now() - frame.published).count();
+		float alpha = std::min(1.0f, frame.alpha + since / tick_length);
+
+		//clear the depth+color buffers and set some default state:
+		glClearColor(0.5, 0.5, 0.5, 0.0);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glEnable(GL_DEPTH_TEST);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+		game->draw(frame.drawable_size, frame.game, alpha);
+		if (game->gpu_timers) game->gpu_timers->report_every(5.0f, std::cout);
+
+		//Finally, wait until the recently-drawn frame is shown:
+		PROFILE_ZONE("swap");
+		SDL_GL_SwapWindow(window);
+
+		if (!first_frame_shown) {
+			first_frame_shown = true;
+			startup_phase_done("first frame");
+			if (config.startup_times) report_startup();
+		}
+	};
+
+	publish(); //(so there is always a frame to draw)
+
+	//with --render-thread, the OpenGL context moves to a thread that just draws published frames:
+	std::thread render_thread;
+	std::atomic< bool > render_quit(false);
+	std::mutex render_mutex; //(only used to sleep until a frame is published in redraw-on-change mode)
+	std::condition_variable render_wake;
+
+	if (config.render_thread) {
+		SDL_GL_MakeCurrent(window, NULL); //release the context so the render thread can take it
+		render_thread = std::thread([&](){
+			profile_name_thread("render");
+			SDL_GL_MakeCurrent(window, context);
+			while (!render_quit) {
+				if (config.redraw_on_change && !frames.fresh() && !frames.front().animating) {
+					std::unique_lock< std::mutex > lock(render_mutex);
+					render_wake.wait(lock, [&](){ return frames.fresh() || render_quit; });
+					if (render_quit) break;
+				}
+				draw_frame();
+			}
+			SDL_GL_MakeCurrent(window, NULL);
+		});
+	}
+
+	auto wake_render_thread = [&]() {
+		if (!render_thread.joinable()) return;
+		{ //(taking the lock means the render thread is either not yet checking, or already waiting)
+			std::lock_guard< std::mutex > lock(render_mutex);
+		}
+		render_wake.notify_one();
+	};
+
+	auto stop_render_thread = [&]() {
+		if (!render_thread.joinable()) return;
+		render_quit = true;
+		wake_render_thread();
+		render_thread.join();
+		SDL_GL_MakeCurrent(window, context); //take the context back (e.g., so Game can free its resources)
+	};
+
 	//This will loop until the game object is set to null:
 	while (game) {
 		//every pass through the game loop creates one frame of output
@@ -117,15 +349,46 @@ int main(int argc, char **argv) {
 
 		{ //(1) process any events that are pending
 			static SDL_Event evt;
-			while (SDL_PollEvent(&evt) == 1) {
+			//how long to wait for the first event:
+			// - with nothing changing in redraw-on-change mode, until there is one (the timeout just keeps the tick clock from stalling for too long)
+			// - with a render thread (which does the vsync wait), until the next tick is due
+			// - otherwise, not at all
+			int wait_ms = 0;
+			if (config.redraw_on_change && !game->dirty && !game->animating()) {
+				wait_ms = 500;
+			} else if (render_thread.joinable()) {
+				wait_ms = std::max(1, int(std::ceil((tick_length - accumulator) * 1000.0f)));
+			}
+			while ((wait_ms ? SDL_WaitEventTimeout(&evt, wait_ms) : SDL_PollEvent(&evt)) == 1) {
+				wait_ms = 0; //after the first event, just drain the queue
+				PROFILE_ZONE("event");
+				//F9 writes out a trace of the last few seconds:
+				if (evt.type == SDL_KEYDOWN && evt.key.keysym.scancode == SDL_SCANCODE_F9 && evt.key.repeat == 0) {
+					//(a failed dump shouldn't end the game)
+					try {
+						profile_write_chrome_trace(config.trace, config.trace_seconds);
+						std::cout << "Wrote the last " << config.trace_seconds << "s of profile zones to '" << config.trace << "'." << std::endl;
+					} catch (std::exception &e) {
+						std::cerr << "Failed to write trace: " << e.what() << std::endl;
+					}
+					continue;
+				}
 				//handle resizing:
 				if (evt.type == SDL_WINDOWEVENT && evt.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
 					on_resize();
 				}
+				//the window contents may need to be redrawn (e.g., it was uncovered or resized):
+				if (evt.type == SDL_WINDOWEVENT && game) {
+					game->dirty = true;
+				}
 				//handle input:
 				if (game && game->handle_event(evt, window_size)) {
 					// mode handled it; great
 				} else if (evt.type == SDL_QUIT) {
+					if (game->recording) {
+						game->recording->finish(game->kitchen, game->tick);
+					}
+					stop_render_thread(); //(it draws using game)
 					game.reset(); //done: deallocate game
 					break;
 				}
@@ -133,38 +396,59 @@ int main(int argc, char **argv) {
 			if (!game) break;
 		}
 
-		{ //(2) call the game's "update" function to deal with elapsed time:
+		{ //(2) call the game's "update" function once for every whole tick that has elapsed:
+			PROFILE_ZONE("update");
 			auto current_time = std::chrono::high_resolution_clock::now();
 			static auto previous_time = current_time;
 			float elapsed = std::chrono::duration< float >(current_time - previous_time).count();
 			previous_time = current_time;
 
-			//if frames are taking a very long time to process,
-			//lag to avoid spiral of death:
-			elapsed = std::min(0.1f, elapsed);
+			//slow frames are caught up on by running extra ticks, but an
+			//extremely long stall (e.g., sitting in a debugger) is dropped rather than replayed:
+			accumulator += std::min(1.0f, elapsed);
 
-			game->update(elapsed);
-			if (!game) break;
+			while (accumulator >= tick_length) {
+				game->update(tick_length);
+				accumulator -= tick_length;
+			}
 		}
 
-		{ //(3) call the game's "draw" function to produce output:
-			//clear the depth+color buffers and set some default state:
-			glClearColor(0.5, 0.5, 0.5, 0.0);
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			glEnable(GL_DEPTH_TEST);
-			glEnable(GL_BLEND);
-			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		//in redraw-on-change mode, skip drawing (and swapping) frames that would look the same as the last one:
+		if (config.redraw_on_change && !game->dirty && !game->animating()) continue;
 
-			game->draw(drawable_size);
+		//(3) hand the state to the drawing code, and -- without a render thread -- draw it:
+		publish();
+		if (render_thread.joinable()) {
+			wake_render_thread();
+		} else {
+			draw_frame();
 		}
 
-		//Finally, wait until the recently-drawn frame is shown before doing it all again:
-		SDL_GL_SwapWindow(window);
+		//(then print any OpenGL debug messages collected during the frame)
+		gl_debug_flush(std::cerr);
 	}
 
+	stop_render_thread();
+	gl_debug_flush(std::cerr);
+
 
 	//------------  teardown ------------
 
+	if (config.trace_on_exit) {
+		//(a failed dump shouldn't keep the recording from being saved)
+		try {
+			profile_write_chrome_trace(config.trace, config.trace_seconds);
+			std::cout << "Wrote the last " << config.trace_seconds << "s of profile zones to '" << config.trace << "'." << std::endl;
+		} catch (std::exception &e) {
+			std::cerr << "Failed to write trace: " << e.what() << std::endl;
+		}
+	}
+
+	if (!config.record.empty()) {
+		recording.save(config.record);
+		std::cout << "Saved " << recording.events.size() << " actions over " << recording.header.ticks << " ticks to '" << config.record << "'." << std::endl;
+	}
+
 	SDL_GL_DeleteContext(context);
 	context = 0;
 
@@ -0,0 +1,111 @@
+//make-par-table solves every spawn layout with a breadth-first search over
+// (chef square, held food) using the rules in KitchenState::step, and writes
+// the optimal move count and first action of every state to a par blob:
+//
+//   make-par-table [--compress] dist/par.blob
+//
+// (The output only changes when the rules do; a copy is checked in as dist/par.blob.)
+// With --compress, the table is stored as a compressed chunk (see compressed_chunk.hpp).
+
+#include "Kitchen.hpp"
+#include "ParTable.hpp"
+#include "write_chunk.hpp" //helper for writing a vector of structures to a file
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv) {
+	bool compress = (argc == 3 && std::string(argv[1]) == "--compress");
+	if (argc != 2 && !compress) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [--compress] <out.blob>" << std::endl;
+		return 1;
+	}
+	char const *filename = argv[argc - 1];
+
+	//every layout has the same 72 states: chef square (0-8) * 8 + held food (0-7):
+	static const uint32_t States = 9 * 8;
+	static const uint32_t Delivered = States; //extra node standing for "round over"
+
+	std::vector< uint8_t > entries(ParTable::Size, 0);
+	uint32_t worst = 0;
+
+	for (uint32_t pb = 0; pb < 12; ++pb) {
+	for (uint32_t j = 0; j < 12; ++j) {
+	for (uint32_t bread = 0; bread < 12; ++bread) {
+	for (uint32_t goal = 0; goal < 12; ++goal) {
+		if (pb == j || pb == bread || pb == goal || j == bread || j == goal || bread == goal) continue;
+		uint32_t layout = ParTable::layout_index(pb, j, bread, goal);
+
+		//apply every action in every state to find the edges of the state graph:
+		uint32_t next[States][4];
+		for (uint32_t s = 0; s < States; ++s) {
+			uint32_t chef = s / 8;
+			uint8_t held = uint8_t(s % 8);
+
+			KitchenState state;
+			state.held = held;
+			state.masks[KitchenState::ChefLayer] = KitchenState::square_bit(1 + chef / 3, 1 + chef % 3);
+			state.masks[KitchenState::PBLayer] = (held & KitchenState::HeldPB) ? 0 : 1u << KitchenState::CounterSquares[pb];
+			state.masks[KitchenState::JLayer] = (held & KitchenState::HeldJ) ? 0 : 1u << KitchenState::CounterSquares[j];
+			state.masks[KitchenState::BreadLayer] = (held & KitchenState::HeldBread) ? 0 : 1u << KitchenState::CounterSquares[bread];
+			state.masks[KitchenState::GoalLayer] = 1u << KitchenState::CounterSquares[goal];
+			state.masks[KitchenState::CounterLayer] = KitchenState::CounterRingMask & ~(
+				state.masks[KitchenState::PBLayer] | state.masks[KitchenState::JLayer]
+				| state.masks[KitchenState::BreadLayer] | state.masks[KitchenState::GoalLayer]);
+
+			for (uint32_t a = 0; a < 4; ++a) {
+				KitchenState after = state;
+				if (after.step(KitchenState::Action(a)) == KitchenState::Delivered) {
+					next[s][a] = Delivered;
+				} else {
+					uint32_t after_chef = (after.chef_x() - 1) * 3 + (after.chef_y() - 1);
+					next[s][a] = after_chef * 8 + after.held;
+				}
+			}
+		}
+
+		//breadth-first search backward from delivery:
+		std::vector< uint32_t > dist(States + 1, ~0u);
+		dist[Delivered] = 0;
+		std::vector< uint32_t > queue;
+		queue.reserve(States + 1);
+		queue.push_back(Delivered);
+		for (uint32_t q = 0; q < queue.size(); ++q) {
+			uint32_t to = queue[q];
+			for (uint32_t s = 0; s < States; ++s) {
+				if (dist[s] != ~0u) continue;
+				for (uint32_t a = 0; a < 4; ++a) {
+					if (next[s][a] == to) {
+						dist[s] = dist[to] + 1;
+						queue.push_back(s);
+						break;
+					}
+				}
+			}
+		}
+
+		for (uint32_t s = 0; s < States; ++s) {
+			if (dist[s] == ~0u || dist[s] >= 64) {
+				std::cerr << "State " << s << " of layout " << layout << " has no usable solution." << std::endl;
+				return 1;
+			}
+			uint32_t first = 0;
+			while (dist[next[s][first]] + 1 != dist[s]) ++first;
+
+			entries[layout * States + s] = uint8_t((dist[s] << 2) | first);
+			if (dist[s] > worst) worst = dist[s];
+		}
+	}}}}
+
+	std::ofstream out(filename, std::ios::binary);
+	if (compress) {
+		write_compressed_chunk("par0", entries, &out);
+	} else {
+		write_chunk("par0", entries, &out);
+	}
+	std::cout << "Wrote " << entries.size() << " entries (longest solution: " << worst << " moves) in " << out.tellp() << " bytes to '" << filename << "'." << std::endl;
+
+	return 0;
+}
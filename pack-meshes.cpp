@@ -0,0 +1,370 @@
+//pack-meshes turns the triangle soup written by meshes/export-meshes.py into
+// indexed meshes ready for glDrawElements:
+//
+//   pack-meshes [--compact] [--compress] meshes/meshes.soup.blob dist/meshes.blob
+//
+// For each mesh it welds byte-identical vertices, orders the triangles for
+// post-transform vertex cache reuse (Tom Forsyth's "Linear-Speed Vertex Cache
+// Optimisation"), and renumbers the vertices in the order they are first used.
+//
+// With --compact, vertices are stored in 16 bytes instead of 28: positions as
+// 16-bit fractions of the mesh's bounding box, normals as GL_INT_2_10_10_10_REV,
+// and the color unchanged.
+//
+// With --compress, every chunk is stored compressed (see compressed_chunk.hpp).
+// Compressed chunks are inflated into copies at load time rather than used
+// straight from the mapped file, so this only pays off for large packs.
+//
+// The output starts with a table of contents giving each chunk's offset, size,
+// alignment, and checksum (see blob_toc.hpp).
+//
+// Input chunks:  dat0 (vertices), str0 (names), idx0 (name -> vertex range)
+// Output chunks: dat0 or dat1 (vertices; the digit is the vertex format), str0 (names),
+//   idx2 (name -> vertex range, index range, bounding box), ids0 (name hash -> position
+//   in idx2, sorted by hash; see MeshId.hpp), ind0 (uint32 indices)
+
+#include "read_chunk.hpp" //helper for reading a vector of structures from a file
+#include "write_blob.hpp" //writes chunks with a table of contents
+#include "MeshId.hpp" //name hashes for the id table
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <vector>
+
+struct Vertex {
+	float Position[3];
+	float Normal[3];
+	uint8_t Color[4];
+
+	bool operator<(Vertex const &other) const {
+		return std::memcmp(this, &other, sizeof(Vertex)) < 0;
+	}
+};
+static_assert(sizeof(Vertex) == 28, "Vertex should be packed.");
+
+struct IndexEntry {
+	uint32_t name_begin;
+	uint32_t name_end;
+	uint32_t vertex_begin;
+	uint32_t vertex_end;
+};
+static_assert(sizeof(IndexEntry) == 16, "IndexEntry should be packed.");
+
+//compact ("dat1") vertex:
+struct CompactVertex {
+	uint16_t Position[4]; //fraction of the way across the mesh's bounding box (* 65535); last component is padding
+	uint32_t Normal; //GL_INT_2_10_10_10_REV (x in the low bits)
+	uint8_t Color[4];
+};
+static_assert(sizeof(CompactVertex) == 16, "CompactVertex should be packed.");
+
+struct IndexedEntry {
+	uint32_t name_begin;
+	uint32_t name_end;
+	uint32_t vertex_begin;
+	uint32_t vertex_end;
+	uint32_t index_begin;
+	uint32_t index_end;
+	float min[3]; //bounding box of the mesh's positions
+	float max[3];
+};
+static_assert(sizeof(IndexedEntry) == 48, "IndexedEntry should be packed.");
+
+static CompactVertex compact(Vertex const &v, IndexedEntry const &e) {
+	CompactVertex c;
+	for (uint32_t i = 0; i < 3; ++i) {
+		float extent = e.max[i] - e.min[i];
+		float t = (extent > 0.0f ? (v.Position[i] - e.min[i]) / extent : 0.0f);
+		c.Position[i] = uint16_t(std::round(std::min(1.0f, std::max(0.0f, t)) * 65535.0f));
+	}
+	c.Position[3] = 0;
+
+	c.Normal = 0;
+	for (uint32_t i = 0; i < 3; ++i) {
+		int32_t n = int32_t(std::round(std::min(1.0f, std::max(-1.0f, v.Normal[i])) * 511.0f));
+		c.Normal |= (uint32_t(n) & 0x3ff) << (10 * i);
+	}
+
+	for (uint32_t i = 0; i < 4; ++i) {
+		c.Color[i] = v.Color[i];
+	}
+	return c;
+}
+
+//Forsyth's scoring parameters (from the paper):
+static const uint32_t CacheSize = 32;
+static const float CacheDecayPower = 1.5f;
+static const float LastTriScore = 0.75f;
+static const float ValenceBoostScale = 2.0f;
+static const float ValenceBoostPower = 0.5f;
+
+//score of a vertex at 'position' in the (simulated) cache with 'remaining' unemitted triangles:
+static float vertex_score(int32_t position, uint32_t remaining) {
+	if (remaining == 0) return -1.0f; //no triangles need this vertex any more
+
+	float score = 0.0f;
+	if (position < 0) {
+		//not in cache
+	} else if (position < 3) {
+		//used by the last triangle; a fixed score keeps it from being favored over fresh neighbors:
+		score = LastTriScore;
+	} else {
+		float scaler = 1.0f / (CacheSize - 3);
+		score = std::pow(1.0f - (position - 3) * scaler, CacheDecayPower);
+	}
+	//boost vertices with few triangles left, so they get finished off instead of left as stragglers:
+	score += ValenceBoostScale * std::pow(float(remaining), -ValenceBoostPower);
+	return score;
+}
+
+//reorder triangles (indices into [0, vertex_count)) for vertex cache reuse:
+static std::vector< uint32_t > forsyth_order(std::vector< uint32_t > const &indices, uint32_t vertex_count) {
+	uint32_t triangle_count = uint32_t(indices.size() / 3);
+
+	//triangles using each vertex:
+	std::vector< uint32_t > remaining(vertex_count, 0);
+	for (uint32_t i : indices) remaining[i] += 1;
+	std::vector< uint32_t > first(vertex_count + 1, 0);
+	for (uint32_t v = 0; v < vertex_count; ++v) first[v + 1] = first[v] + remaining[v];
+	std::vector< uint32_t > triangles_of(indices.size());
+	{
+		std::vector< uint32_t > fill(first.begin(), first.end() - 1);
+		for (uint32_t t = 0; t < triangle_count; ++t) {
+			for (uint32_t k = 0; k < 3; ++k) {
+				uint32_t v = indices[3 * t + k];
+				triangles_of[fill[v]++] = t;
+			}
+		}
+	}
+
+	std::vector< int32_t > cache_position(vertex_count, -1);
+	std::vector< float > score(vertex_count);
+	for (uint32_t v = 0; v < vertex_count; ++v) score[v] = vertex_score(-1, remaining[v]);
+
+	std::vector< bool > emitted(triangle_count, false);
+	std::vector< float > triangle_score(triangle_count);
+	for (uint32_t t = 0; t < triangle_count; ++t) {
+		triangle_score[t] = score[indices[3*t+0]] + score[indices[3*t+1]] + score[indices[3*t+2]];
+	}
+
+	std::vector< uint32_t > cache; //most recent first
+	std::vector< uint32_t > out;
+	out.reserve(indices.size());
+
+	uint32_t next_unemitted = 0; //for restarting when no cached vertex has triangles left
+	uint32_t best = ~0u;
+	while (out.size() < indices.size()) {
+		if (best == ~0u) {
+			//nothing in the cache is useful; take the best-scoring triangle overall:
+			float best_score = -1.0f;
+			for (uint32_t t = next_unemitted; t < triangle_count; ++t) {
+				if (emitted[t]) continue;
+				if (triangle_score[t] > best_score) {
+					best_score = triangle_score[t];
+					best = t;
+				}
+			}
+			while (next_unemitted < triangle_count && emitted[next_unemitted]) ++next_unemitted;
+		}
+
+		//emit it:
+		emitted[best] = true;
+		for (uint32_t k = 0; k < 3; ++k) {
+			uint32_t v = indices[3 * best + k];
+			out.emplace_back(v);
+			remaining[v] -= 1;
+			//remove from this vertex's list of triangles:
+			auto begin = triangles_of.begin() + first[v];
+			auto end = begin + remaining[v] + 1;
+			*std::find(begin, end, best) = *(end - 1);
+		}
+
+		//move its vertices to the front of the cache:
+		std::vector< uint32_t > new_cache;
+		new_cache.reserve(CacheSize + 3);
+		for (uint32_t k = 0; k < 3; ++k) new_cache.emplace_back(indices[3 * best + k]);
+		for (uint32_t v : cache) {
+			if (std::find(new_cache.begin(), new_cache.end(), v) == new_cache.end()) new_cache.emplace_back(v);
+		}
+
+		//rescore everything that was or is in the cache, then the triangles that touch it:
+		for (uint32_t p = 0; p < new_cache.size(); ++p) {
+			uint32_t v = new_cache[p];
+			cache_position[v] = (p < CacheSize ? int32_t(p) : -1);
+			score[v] = vertex_score(cache_position[v], remaining[v]);
+		}
+		best = ~0u;
+		float best_score = -1.0f;
+		for (uint32_t v : new_cache) {
+			for (uint32_t i = first[v]; i < first[v] + remaining[v]; ++i) {
+				uint32_t t = triangles_of[i];
+				triangle_score[t] = score[indices[3*t+0]] + score[indices[3*t+1]] + score[indices[3*t+2]];
+				if (triangle_score[t] > best_score) {
+					best_score = triangle_score[t];
+					best = t;
+				}
+			}
+		}
+
+		if (new_cache.size() > CacheSize) new_cache.resize(CacheSize);
+		cache.swap(new_cache);
+	}
+
+	return out;
+}
+
+//average vertex shader invocations per triangle with a FIFO cache of 'size' entries:
+static float acmr(std::vector< uint32_t > const &indices, uint32_t size) {
+	std::vector< uint32_t > fifo;
+	uint32_t misses = 0;
+	for (uint32_t i : indices) {
+		if (std::find(fifo.begin(), fifo.end(), i) == fifo.end()) {
+			misses += 1;
+			fifo.emplace_back(i);
+			if (fifo.size() > size) fifo.erase(fifo.begin());
+		}
+	}
+	return indices.empty() ? 0.0f : float(misses) / float(indices.size() / 3);
+}
+
+int main(int argc, char **argv) {
+	bool compact_vertices = false;
+	bool compress = false;
+	std::vector< std::string > files;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--compact") {
+			compact_vertices = true;
+		} else if (arg == "--compress") {
+			compress = true;
+		} else {
+			files.emplace_back(arg);
+		}
+	}
+	if (files.size() != 2) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [--compact] [--compress] <in.blob> <out.blob>\n(in.blob is the output of meshes/export-meshes.py)" << std::endl;
+		return 1;
+	}
+
+	std::vector< Vertex > soup;
+	std::vector< char > names;
+	std::vector< IndexEntry > entries;
+	{
+		std::ifstream in(files[0], std::ios::binary);
+		if (!in) {
+			std::cerr << "Failed to open '" << files[0] << "'." << std::endl;
+			return 1;
+		}
+		read_chunk(in, "dat0", &soup);
+		read_chunk(in, "str0", &names);
+		read_chunk(in, "idx0", &entries);
+	}
+
+	std::vector< Vertex > vertices;
+	std::vector< uint32_t > indices;
+	std::vector< IndexedEntry > indexed;
+
+	for (IndexEntry const &e : entries) {
+		if (e.vertex_begin > e.vertex_end || e.vertex_end > soup.size() || (e.vertex_end - e.vertex_begin) % 3 != 0) {
+			std::cerr << "Invalid vertex range in index." << std::endl;
+			return 1;
+		}
+		if (e.name_begin > e.name_end || e.name_end > names.size()) {
+			std::cerr << "Invalid name range in index." << std::endl;
+			return 1;
+		}
+		std::string name(names.begin() + e.name_begin, names.begin() + e.name_end);
+
+		//weld identical vertices:
+		std::map< Vertex, uint32_t > welded;
+		std::vector< Vertex > mesh_vertices;
+		std::vector< uint32_t > mesh_indices;
+		for (uint32_t i = e.vertex_begin; i < e.vertex_end; ++i) {
+			auto ret = welded.insert(std::make_pair(soup[i], uint32_t(mesh_vertices.size())));
+			if (ret.second) mesh_vertices.emplace_back(soup[i]);
+			mesh_indices.emplace_back(ret.first->second);
+		}
+
+		//reorder triangles for the post-transform cache:
+		float before = acmr(mesh_indices, 16);
+		mesh_indices = forsyth_order(mesh_indices, uint32_t(mesh_vertices.size()));
+		float after = acmr(mesh_indices, 16);
+
+		//renumber vertices in order of first use (for pre-transform fetch locality):
+		std::vector< uint32_t > renumber(mesh_vertices.size(), ~0u);
+		IndexedEntry out;
+		out.name_begin = e.name_begin;
+		out.name_end = e.name_end;
+		out.vertex_begin = uint32_t(vertices.size());
+		out.index_begin = uint32_t(indices.size());
+		for (uint32_t i : mesh_indices) {
+			if (renumber[i] == ~0u) {
+				renumber[i] = uint32_t(vertices.size() - out.vertex_begin);
+				vertices.emplace_back(mesh_vertices[i]);
+			}
+			indices.emplace_back(out.vertex_begin + renumber[i]);
+		}
+		out.vertex_end = uint32_t(vertices.size());
+		out.index_end = uint32_t(indices.size());
+		for (uint32_t i = 0; i < 3; ++i) {
+			out.min[i] = out.max[i] = (out.vertex_begin < out.vertex_end ? vertices[out.vertex_begin].Position[i] : 0.0f);
+			for (uint32_t v = out.vertex_begin; v < out.vertex_end; ++v) {
+				out.min[i] = std::min(out.min[i], vertices[v].Position[i]);
+				out.max[i] = std::max(out.max[i], vertices[v].Position[i]);
+			}
+		}
+		indexed.emplace_back(out);
+
+		std::cout << "'" << name << "': " << (e.vertex_end - e.vertex_begin) << " -> " << (out.vertex_end - out.vertex_begin) << " vertices; "
+			<< "ACMR " << before << " -> " << after << " (16-entry FIFO)." << std::endl;
+	}
+
+	//table for resolving names to ids (= positions in the index) by hash:
+	std::vector< MeshIdEntry > ids;
+	for (IndexedEntry const &e : indexed) {
+		MeshIdEntry id;
+		id.hash = mesh_name_hash(std::string(names.begin() + e.name_begin, names.begin() + e.name_end).c_str());
+		id.id = MeshId(ids.size());
+		ids.emplace_back(id);
+	}
+	std::sort(ids.begin(), ids.end(), [](MeshIdEntry const &a, MeshIdEntry const &b) {
+		return a.hash < b.hash;
+	});
+	for (uint32_t i = 1; i < ids.size(); ++i) {
+		if (ids[i-1].hash == ids[i].hash) {
+			IndexedEntry const &a = indexed[ids[i-1].id];
+			IndexedEntry const &b = indexed[ids[i].id];
+			std::cerr << "Mesh names '" << std::string(names.begin() + a.name_begin, names.begin() + a.name_end)
+				<< "' and '" << std::string(names.begin() + b.name_begin, names.begin() + b.name_end)
+				<< "' have the same hash; rename one." << std::endl;
+			return 1;
+		}
+	}
+
+	BlobWriter writer;
+	if (compact_vertices) {
+		std::vector< CompactVertex > compacted;
+		compacted.reserve(vertices.size());
+		for (IndexedEntry const &e : indexed) {
+			for (uint32_t v = e.vertex_begin; v < e.vertex_end; ++v) {
+				compacted.emplace_back(compact(vertices[v], e));
+			}
+		}
+		writer.add("dat1", compacted, compress);
+	} else {
+		writer.add("dat0", vertices, compress);
+	}
+	writer.add("str0", names, compress);
+	writer.add("idx2", indexed, compress);
+	writer.add("ids0", ids, compress);
+	writer.add("ind0", indices, compress);
+	std::ofstream out(files[1], std::ios::binary);
+	writer.write(&out);
+	std::cout << "Wrote " << out.tellp() << " bytes (" << vertices.size() << (compact_vertices ? " compact" : "") << " vertices, " << indices.size() << " indices; was " << soup.size() << " vertices)" << (compress ? ", compressed," : "") << " to '" << files[1] << "'." << std::endl;
+
+	return 0;
+}
@@ -5,6 +5,10 @@
 #include <stdexcept>
 #include <cassert>
 
+#include "compressed_chunk.hpp" //chunks may also be stored compressed
+
+//read_chunk reads a vector of structures prefixed by a magic number and size;
+// the chunk may also be compressed (see compressed_chunk.hpp), in which case it is inflated:
 template< typename T >
 void read_chunk(std::istream &from, std::string const &magic, std::vector< T > *_to) {
 	assert(_to);
@@ -21,16 +25,32 @@ void read_chunk(std::istream &from, std::string const &magic, std::vector< T > *
 	if (!from.read(reinterpret_cast< char * >(&header), sizeof(header))) {
 		throw std::runtime_error("Failed to read chunk header");
 	}
+	bool compressed = (uint8_t(header.magic[0]) & CompressedMagicFlag) != 0;
+	header.magic[0] = char(uint8_t(header.magic[0]) & ~CompressedMagicFlag);
 	if (std::string(header.magic,4) != magic) {
 		throw std::runtime_error("Unexpected magic number in chunk");
 	}
 
+	if (compressed) {
+		std::vector< uint8_t > data(header.size);
+		if (!from.read(reinterpret_cast< char * >(data.data()), data.size())) {
+			throw std::runtime_error("Failed to read chunk data.");
+		}
+		size_t size = inflated_chunk_size(data.data(), data.size());
+		if (size % sizeof(T) != 0) {
+			throw std::runtime_error("Size of chunk not divisible by element size");
+		}
+		to.resize(size / sizeof(T));
+		inflate_chunk_data(data.data(), data.size(), reinterpret_cast< uint8_t * >(to.data()));
+		return;
+	}
+
 	if (header.size % sizeof(T) != 0) {
 		throw std::runtime_error("Size of chunk not divisible by element size");
 	}
 
 	to.resize(header.size / sizeof(T));
-	if (!from.read(reinterpret_cast< char * >(&to[0]), to.size() * sizeof(T))) {
+	if (!from.read(reinterpret_cast< char * >(to.data()), to.size() * sizeof(T))) {
 		throw std::runtime_error("Failed to read chunk data.");
 	}
 }
@@ -0,0 +1,257 @@
+//sim plays rounds of Undercooked headless (no window, no OpenGL) using a
+// simple bot, and reports how fast the rules run.
+//
+// usage: sim [--rounds N] [--seed S] [--policy greedy|random|par] [--threads N] [--scaling]
+//            [--batch N [--kernel scalar|sse2|avx2]] [--replay FILE [--repeat N]]
+//  --threads plays independent rounds on N worker threads with Rollout
+//  --scaling repeats the run with 1, 2, 4, ... N threads and reports speedup
+//  --batch steps N kitchens at once with KitchenBatch (random policy only)
+//  --replay plays a recorded session (see Replay.hpp) headless, N times, and checks the result
+// If dist/par.blob (from make-par-table) is present, results are also scored against par.
+
+#include "Kitchen.hpp"
+#include "KitchenBatch.hpp"
+#include "Rollout.hpp"
+#include "ParTable.hpp"
+#include "data_path.hpp"
+#include "Replay.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+#include <thread>
+
+//greedy bot: walk to the square next to the nearest thing still needed, then push into it:
+static KitchenState::Action greedy_policy(KitchenState const &state, Rng &) {
+	uint32_t wanted = 0;
+	if (state.held == KitchenState::HeldAll) {
+		wanted = state.masks[KitchenState::GoalLayer];
+	} else {
+		wanted = state.masks[KitchenState::PBLayer] | state.masks[KitchenState::JLayer] | state.masks[KitchenState::BreadLayer];
+	}
+
+	int chef_x = int(state.chef_x());
+	int chef_y = int(state.chef_y());
+
+	int best_x = 0, best_y = 0;
+	int best_dist = 100;
+	for (int x = 0; x < 5; ++x) {
+		for (int y = 0; y < 5; ++y) {
+			if (!(wanted & KitchenState::square_bit(x, y))) continue;
+			int dist = std::abs(x - chef_x) + std::abs(y - chef_y);
+			if (dist < best_dist) {
+				best_dist = dist;
+				best_x = x;
+				best_y = y;
+			}
+		}
+	}
+
+	//walk to the floor square next to the target:
+	int stand_x = std::min(std::max(best_x, 1), 3);
+	int stand_y = std::min(std::max(best_y, 1), 3);
+	if (stand_x != chef_x || stand_y != chef_y) {
+		best_x = stand_x;
+		best_y = stand_y;
+	}
+
+	if (best_x > chef_x) return KitchenState::Up;
+	if (best_x < chef_x) return KitchenState::Down;
+	if (best_y < chef_y) return KitchenState::Left;
+	return KitchenState::Right;
+}
+
+static KitchenState::Action random_policy(KitchenState const &, Rng &rng) {
+	return KitchenState::Action(rng() >> 30);
+}
+
+//par bot: look up the optimal action:
+static ParTable par_table;
+static KitchenState::Action par_policy(KitchenState const &state, Rng &) {
+	return par_table.first_action(state);
+}
+
+int main(int argc, char **argv) {
+	struct {
+		uint64_t rounds = 1000000;
+		uint64_t seed = 0;
+		Rollout::Policy policy = greedy_policy;
+		uint32_t threads = 1;
+		bool scaling = false;
+		uint32_t batch = 0; //if nonzero, step this many kitchens at once
+		KitchenBatch::Kernel kernel = KitchenBatch::best_kernel();
+		std::string replay; //if set, play this replay instead
+		uint32_t repeat = 1;
+	} config;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--rounds" && i + 1 < argc) {
+			config.rounds = std::strtoull(argv[++i], nullptr, 10);
+		} else if (arg == "--seed" && i + 1 < argc) {
+			config.seed = std::strtoull(argv[++i], nullptr, 10);
+		} else if (arg == "--policy" && i + 1 < argc) {
+			std::string policy = argv[++i];
+			if (policy == "random") config.policy = random_policy;
+			else if (policy == "greedy") config.policy = greedy_policy;
+			else if (policy == "par") config.policy = par_policy;
+			else {
+				std::cerr << "Unknown policy '" << policy << "'." << std::endl;
+				return 1;
+			}
+		} else if (arg == "--threads" && i + 1 < argc) {
+			config.threads = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+			if (config.threads == 0) config.threads = std::max(1u, std::thread::hardware_concurrency());
+		} else if (arg == "--scaling") {
+			config.scaling = true;
+		} else if (arg == "--replay" && i + 1 < argc) {
+			config.replay = argv[++i];
+		} else if (arg == "--repeat" && i + 1 < argc) {
+			config.repeat = std::max(1u, uint32_t(std::strtoul(argv[++i], nullptr, 10)));
+		} else if (arg == "--batch" && i + 1 < argc) {
+			config.batch = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+		} else if (arg == "--kernel" && i + 1 < argc) {
+			std::string kernel = argv[++i];
+			if (kernel == "scalar") config.kernel = KitchenBatch::Scalar;
+			else if (kernel == "sse2") config.kernel = KitchenBatch::SSE2;
+			else if (kernel == "avx2") config.kernel = KitchenBatch::AVX2;
+			else {
+				std::cerr << "Unknown kernel '" << kernel << "'." << std::endl;
+				return 1;
+			}
+			if (config.kernel > KitchenBatch::best_kernel()) {
+				std::cerr << "This CPU does not support the '" << kernel << "' kernel." << std::endl;
+				return 1;
+			}
+		} else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--rounds N] [--seed S] [--policy greedy|random|par] [--threads N] [--scaling] [--batch N [--kernel scalar|sse2|avx2]] [--replay FILE [--repeat N]]" << std::endl;
+			return 1;
+		}
+	}
+
+	auto report = [](uint64_t rounds, uint64_t steps, double seconds) {
+		std::cout << "rounds: " << rounds << "\n";
+		std::cout << "steps: " << steps << "\n";
+		std::cout << "steps per round: " << double(steps) / double(rounds) << "\n";
+		std::cout << "seconds: " << seconds << "\n";
+		std::cout << "rounds per second: " << double(rounds) / seconds << "\n";
+		std::cout << "steps per second: " << double(steps) / seconds << std::endl;
+	};
+
+	if (!config.replay.empty()) {
+		Replay replay;
+		try {
+			replay.load(config.replay);
+		} catch (std::exception &e) {
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+
+		bool matches = true;
+		uint64_t rounds = 0;
+		auto before = std::chrono::high_resolution_clock::now();
+		for (uint32_t r = 0; r < config.repeat; ++r) {
+			KitchenState state = replay.play();
+			matches = matches && replay.matches(state);
+			rounds += state.rounds;
+		}
+		auto after = std::chrono::high_resolution_clock::now();
+
+		report(rounds, uint64_t(replay.events.size()) * config.repeat, std::chrono::duration< double >(after - before).count());
+		if (!matches) {
+			std::cerr << "Replay does not reproduce the recorded session." << std::endl;
+			return 1;
+		}
+		std::cout << "Replay reproduces the recorded session." << std::endl;
+		return 0;
+	}
+
+	if (config.batch) {
+		KitchenBatch batch(config.batch, config.seed);
+		batch.kernel = config.kernel;
+		std::cout << "kernel: " << KitchenBatch::kernel_name(batch.kernel) << "\n";
+
+		uint64_t rounds = 0;
+		uint64_t steps = 0;
+		auto before = std::chrono::high_resolution_clock::now();
+
+		std::vector< KitchenState::Action > actions(batch.size());
+		Rng policy_rng(Rng::mix(config.seed));
+		while (rounds < config.rounds) {
+			//two bits per action:
+			for (uint32_t i = 0; i < actions.size(); i += 32) {
+				uint64_t bits = policy_rng.next();
+				for (uint32_t k = i; k < i + 32 && k < actions.size(); ++k, bits >>= 2) {
+					actions[k] = KitchenState::Action(bits & 3);
+				}
+			}
+			batch.step(actions.data());
+			steps += batch.size();
+			if (steps % (64 * uint64_t(batch.size())) == 0) {
+				rounds = 0;
+				for (uint32_t r : batch.rounds) rounds += r;
+			}
+		}
+		auto after = std::chrono::high_resolution_clock::now();
+		report(rounds, steps, std::chrono::duration< double >(after - before).count());
+		return 0;
+	}
+
+	try {
+		par_table.load(data_path("par.blob"));
+	} catch (std::exception &e) {
+		if (config.policy == par_policy) {
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+		std::cerr << "NOTE: not scoring against par (" << e.what() << ")." << std::endl;
+	}
+
+	Rollout rollout(config.policy);
+	rollout.seed = config.seed;
+	if (!par_table.entries.empty()) rollout.par = &par_table;
+
+	//run with the given number of threads, returning rounds per second:
+	auto run = [&](uint32_t threads) -> double {
+		auto before = std::chrono::high_resolution_clock::now();
+		Rollout::Stats stats = rollout.run(config.rounds, threads);
+		auto after = std::chrono::high_resolution_clock::now();
+		double seconds = std::chrono::duration< double >(after - before).count();
+
+		std::cout << "threads: " << threads << "\n";
+		report(stats.rounds, stats.steps, seconds);
+		std::cout << "delivered: " << stats.delivered << " (steps min " << stats.min_steps << ", max " << stats.max_steps << ")" << std::endl;
+		if (rollout.par) {
+			std::cout << "par per round: " << double(stats.par) / double(stats.rounds) << "\n";
+			std::cout << "steps over par: " << double(stats.steps - stats.par) / double(stats.rounds) << std::endl;
+		}
+		return double(stats.rounds) / seconds;
+	};
+
+	if (!config.scaling) {
+		run(config.threads);
+		return 0;
+	}
+
+	std::vector< uint32_t > counts;
+	for (uint32_t t = 1; t < config.threads; t *= 2) counts.push_back(t);
+	counts.push_back(config.threads);
+
+	std::vector< double > rates;
+	for (uint32_t t : counts) {
+		rates.push_back(run(t));
+		std::cout << std::endl;
+	}
+
+	std::cout << "threads\trounds/s\tspeedup\tefficiency\n";
+	for (uint32_t i = 0; i < counts.size(); ++i) {
+		double speedup = rates[i] / rates[0];
+		std::cout << counts[i] << "\t" << rates[i] << "\t" << speedup << "\t" << speedup / counts[i] << "\n";
+	}
+	std::cout.flush();
+
+	return 0;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "blob_toc.hpp" //file layout
+#include "compressed_chunk.hpp" //chunks may be stored compressed
+#include "crc32c.hpp" //chunk checksums
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// BlobWriter collects chunks and writes them as a pack with a table of
+// contents (see blob_toc.hpp), which Blob reads:
+//
+//   BlobWriter writer;
+//   writer.add("dat0", vertices);
+//   writer.add("ind0", indices, true); //(compressed)
+//   writer.write(&out);
+
+struct BlobWriter {
+	struct Chunk {
+		std::string magic; //(with the compressed flag, if any)
+		std::vector< uint8_t > data; //as stored
+		uint32_t alignment = 16;
+	};
+	std::vector< Chunk > chunks;
+
+	//add a chunk holding 'from' (deflated in independent blocks if 'compress'):
+	template< typename T >
+	void add(std::string const &magic, std::vector< T > const &from, bool compress = false) {
+		assert(magic.length() == 4);
+		for (Chunk const &chunk : chunks) {
+			std::string existing = chunk.magic;
+			existing[0] = char(uint8_t(existing[0]) & ~CompressedMagicFlag);
+			if (existing == magic) {
+				throw std::runtime_error("Blob already has a chunk '" + magic + "'.");
+			}
+		}
+		chunks.emplace_back();
+		Chunk &chunk = chunks.back();
+		chunk.magic = magic;
+		if (compress) {
+			chunk.magic[0] = char(uint8_t(chunk.magic[0]) | CompressedMagicFlag);
+			chunk.data = compress_chunk_data(from.data(), from.size() * sizeof(T));
+		} else {
+			chunk.data.resize(from.size() * sizeof(T));
+			if (!chunk.data.empty()) std::memcpy(chunk.data.data(), from.data(), chunk.data.size());
+		}
+		//(at least 16, so views of the data are aligned for any element type and for SIMD loads)
+		chunk.alignment = std::max< uint32_t >(16, uint32_t(alignof(T)));
+	}
+
+	//write the header, table of contents, and every chunk added so far:
+	void write(std::ostream *_to) const {
+		assert(_to);
+		auto &to = *_to;
+
+		std::vector< BlobTocEntry > toc(chunks.size());
+		uint64_t offset = sizeof(BlobHeader) + toc.size() * sizeof(BlobTocEntry);
+		for (size_t i = 0; i < chunks.size(); ++i) {
+			Chunk const &chunk = chunks[i];
+			BlobTocEntry &entry = toc[i];
+			std::memcpy(entry.magic, chunk.magic.data(), 4);
+			entry.reserved = 0;
+			offset = (offset + chunk.alignment - 1) / chunk.alignment * chunk.alignment;
+			entry.offset = offset;
+			entry.size = chunk.data.size();
+			entry.alignment = chunk.alignment;
+			entry.checksum = crc32c(chunk.data.data(), chunk.data.size());
+			offset += entry.size;
+		}
+
+		BlobHeader header;
+		std::memcpy(header.magic, BlobHeaderMagic, 4);
+		header.version = BlobVersion;
+		header.chunk_count = uint32_t(toc.size());
+		header.toc_checksum = crc32c(toc.data(), toc.size() * sizeof(BlobTocEntry));
+
+		to.write(reinterpret_cast< char const * >(&header), sizeof(header));
+		to.write(reinterpret_cast< char const * >(toc.data()), toc.size() * sizeof(BlobTocEntry));
+		uint64_t written = sizeof(BlobHeader) + toc.size() * sizeof(BlobTocEntry);
+		for (size_t i = 0; i < chunks.size(); ++i) {
+			std::vector< char > padding(size_t(toc[i].offset - written), '\0');
+			to.write(padding.data(), padding.size());
+			to.write(reinterpret_cast< char const * >(chunks[i].data.data()), chunks[i].data.size());
+			written = toc[i].offset + toc[i].size;
+		}
+		if (!to) {
+			throw std::runtime_error("Failed to write blob.");
+		}
+	}
+};
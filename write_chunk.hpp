@@ -0,0 +1,45 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <cassert>
+
+#include "compressed_chunk.hpp" //for write_compressed_chunk
+
+//write_chunk is the inverse of read_chunk: it writes a vector of structures prefixed by a magic number and size.
+template< typename T >
+void write_chunk(std::string const &magic, std::vector< T > const &from, std::ostream *_to) {
+	assert(_to);
+	assert(magic.length() == 4);
+	auto &to = *_to;
+
+	struct ChunkHeader {
+		char magic[4] = {'\0', '\0', '\0', '\0'};
+		uint32_t size = 0;
+	};
+	static_assert(sizeof(ChunkHeader) == 8, "header is packed");
+
+	ChunkHeader header;
+	header.magic[0] = magic[0];
+	header.magic[1] = magic[1];
+	header.magic[2] = magic[2];
+	header.magic[3] = magic[3];
+	header.size = uint32_t(from.size() * sizeof(T));
+
+	to.write(reinterpret_cast< char const * >(&header), sizeof(header));
+	to.write(reinterpret_cast< char const * >(from.data()), from.size() * sizeof(T));
+	if (!to) {
+		throw std::runtime_error("Failed to write chunk.");
+	}
+}
+
+//write_compressed_chunk writes the same vector as write_chunk, deflated in independent blocks (see compressed_chunk.hpp):
+template< typename T >
+void write_compressed_chunk(std::string const &magic, std::vector< T > const &from, std::ostream *_to) {
+	assert(magic.length() == 4);
+	std::string flagged = magic;
+	flagged[0] = char(uint8_t(flagged[0]) | CompressedMagicFlag);
+	write_chunk(flagged, compress_chunk_data(from.data(), from.size() * sizeof(T)), _to);
+}